@@ -0,0 +1,663 @@
+import std;
+#include <pqxx/pqxx>
+import student_sys;
+
+// ====================== 仓库层微基准 ======================
+// 在独立的schema（student_sys_bench，表结构复制自public）中生成数据，逐个测量仓库方法：
+// 每项先预热再重复测量，单次耗时样本汇总为均值/中位数/p95/最值/标准差，写入JSON文件供不同构建之间对比。
+// 复制的表不含外键，删除类操作的耗时不包括外键检查。
+// 每项同时统计测量阶段的堆分配次数（getAllStudents的每次分配数除以行数即实体解码的每行分配数）。
+// LogStorage::open测量本地日志存储的启动时间（打开数据文件并重放全部记录），不访问数据库。
+// 另有三个单项模式（预编译语句对比、内存目录、选课容量压测），见文件末尾的runSingle
+
+const std::string BENCH_SCHEMA = "student_sys_bench";
+const std::size_t BENCH_COURSES = 100;   // 固定课程数，也是deleteStudent的最大扇出
+const std::size_t BENCH_LOG_WRITERS = 128;   // 生成日志数据文件的并发写线程数（每条写入等待组提交刷盘）
+
+// 堆分配计数：只在基准程序中替换全局operator new，统计所有线程的分配次数
+namespace {
+std::atomic<std::uint64_t> heapAllocations{0};
+}
+
+void* operator new(std::size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// 运行参数
+struct BenchConfig {
+    std::string out = "bench.json";
+    std::vector<std::size_t> sizes{1000, 100000, 1000000};   // getAllStudents等读基准的学生表行数
+    std::size_t warmup = 10;
+    std::size_t reps = 200;
+    std::size_t scanReps = 5;                                // 全表读取的重复次数（每次读取整张表）
+    std::string filter;                                      // 只运行名称包含该子串的基准
+};
+
+// 一项基准的结果
+struct BenchResult {
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> params;
+    std::size_t warmup = 0;
+    std::vector<double> samples;   // 微秒
+    std::uint64_t roundTrips = 0;  // 测量阶段的数据库往返总次数
+    std::uint64_t allocations = 0; // 测量阶段的堆分配总次数
+
+    double percentile(double p) const {
+        if (samples.empty()) return 0.0;
+        std::vector<double> sorted = samples;
+        std::ranges::sort(sorted);
+        auto rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+        return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    double mean() const {
+        return samples.empty() ? 0.0 : std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    }
+
+    double stddev() const {
+        if (samples.size() < 2) return 0.0;
+        double m = mean(), sum = 0.0;
+        for (double s : samples) sum += (s - m) * (s - m);
+        return std::sqrt(sum / (samples.size() - 1));
+    }
+};
+
+class BenchSuite {
+private:
+    BenchConfig config;
+    std::vector<BenchResult> results;
+    std::mt19937_64 rng{42};
+
+    static std::string studentId(std::size_t i) { return std::format("BN-S{:07}", i); }
+    static std::string courseId(std::size_t i) { return std::format("BN-C{:03}", i); }
+
+    // 每次测量前执行setup（不计时），再对op计时
+    bool selected(std::string_view name) const {
+        return config.filter.empty() || name.find(config.filter) != std::string_view::npos;
+    }
+
+    template<typename Setup, typename Op>
+    void measure(std::string name, std::vector<std::pair<std::string, std::string>> params, std::size_t reps,
+                 Setup&& setup, Op&& op) {
+        if (!selected(name)) return;
+        BenchResult result{std::move(name), std::move(params), std::min(config.warmup, reps), {}, 0, 0};
+        for (std::size_t i = 0; i < result.warmup; ++i) {
+            setup(i);
+            op(i);
+        }
+        result.samples.reserve(reps);
+        for (std::size_t i = 0; i < reps; ++i) {
+            setup(result.warmup + i);
+            std::uint64_t trips = DBUtil::roundTrips();
+            std::uint64_t allocations = heapAllocations.load(std::memory_order_relaxed);
+            auto start = std::chrono::steady_clock::now();
+            op(result.warmup + i);
+            result.samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            result.allocations += heapAllocations.load(std::memory_order_relaxed) - allocations;
+            result.roundTrips += DBUtil::roundTrips() - trips;
+        }
+        std::clog << std::format("{:<28}{:<28}均值 {:>10.1f}us  p50 {:>10.1f}us  p95 {:>10.1f}us  分配 {:>10.1f}次\n",
+                                 result.name, paramText(result.params), result.mean(), result.percentile(0.50),
+                                 result.percentile(0.95), static_cast<double>(result.allocations) / reps);
+        results.push_back(std::move(result));
+    }
+
+    template<typename Op>
+    void measure(std::string name, std::vector<std::pair<std::string, std::string>> params, std::size_t reps, Op&& op) {
+        measure(std::move(name), std::move(params), reps, [](std::size_t) {}, std::forward<Op>(op));
+    }
+
+    static std::string paramText(const std::vector<std::pair<std::string, std::string>>& params) {
+        std::string text;
+        for (const auto& [k, v] : params) text += (text.empty() ? "" : " ") + k + "=" + v;
+        return text;
+    }
+
+    static void sql(const std::string& statement) {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.write();
+        conn.execSql(txn, statement);
+        conn.commit(txn);
+    }
+
+    // 建立基准schema：表结构（含主键、唯一约束、默认值、索引）复制自public
+    static void prepareSchema() {
+        pqxx::connection admin(DBUtil::connectionString());
+        pqxx::work txn(admin);
+        txn.exec("CREATE SCHEMA IF NOT EXISTS " + BENCH_SCHEMA);
+        for (const char* table : {"teachers", "students", "courses", "enrollments", "scores"}) {
+            txn.exec(std::format("CREATE TABLE IF NOT EXISTS {0}.{1} (LIKE public.{1} INCLUDING ALL)", BENCH_SCHEMA, table));
+        }
+        txn.commit();
+        DBUtil::connectionString() += " options='-csearch_path=" + BENCH_SCHEMA + "'";
+    }
+
+    // 清空后生成一名教师、BENCH_COURSES门课程和students名学生
+    void seed(std::size_t students) {
+        sql("TRUNCATE scores, enrollments, courses, students, teachers");
+        BulkImportRepository importRepo;
+        std::istringstream teachers("id,name,department\nBN-T0001,基准教师,基准测试\n");
+        importRepo.importTeachers(teachers);
+        std::string csv = "id,name,credit,teacher_id\n";
+        for (std::size_t i = 0; i < BENCH_COURSES; ++i) csv += courseId(i) + ",基准课程,3,BN-T0001\n";
+        std::istringstream courses(csv);
+        importRepo.importCourses(courses);
+        csv = "id,name,major\n";
+        csv.reserve(students * 32);
+        for (std::size_t i = 0; i < students; ++i) csv += studentId(i) + ",基准学生,计算机科学与技术\n";
+        std::istringstream in(csv);
+        importRepo.importStudents(in);
+        sql("ANALYZE");
+    }
+
+    void readBenchmarks() {
+        StudentRepository studentRepo;
+        for (std::size_t size : config.sizes) {
+            seed(size);
+            std::string rows = std::to_string(size);
+            std::uniform_int_distribution<std::size_t> pick(0, size - 1);
+            std::vector<std::string> ids(config.warmup + config.reps);
+            for (auto& id : ids) id = studentId(pick(rng));
+            measure("getStudentById", {{"rows", rows}}, config.reps,
+                    [&](std::size_t i) { studentRepo.getStudentById(ids[i]); });
+            measure("getAllStudents", {{"rows", rows}}, config.scanReps,
+                    [&](std::size_t) { studentRepo.getAllStudents(); });
+            measure("forEachStudent", {{"rows", rows}}, config.scanReps,
+                    [&](std::size_t) { studentRepo.forEachStudent([](const Student&) {}); });
+        }
+    }
+
+    // 计时器自身开销：每个样本为连续构造/析构1000个OperationTimer的总耗时，以微秒计的数值即单次开销的纳秒数
+    void instrumentationBenchmark() {
+        measure("OperationTimer", {{"batch", "1000"}}, config.reps, [](std::size_t) {
+            for (int i = 0; i < 1000; ++i) OperationTimer timer;
+        });
+    }
+
+    void writeBenchmarks() {
+        const std::size_t students = 1000;
+        seed(students);
+        EnrollmentRepository enrollRepo;
+        ScoreRepository scoreRepo;
+        StudentRepository studentRepo;
+
+        // 每名学生预选第0门课程，供成绩录入使用
+        sql("INSERT INTO enrollments (student_id, course_id) SELECT id, 'BN-C000' FROM students");
+        sql(std::format("UPDATE courses SET enrolled = {} WHERE id = 'BN-C000'", students));
+        measure("setScore", {{"rows", std::to_string(students)}}, config.reps, [&](std::size_t i) {
+            scoreRepo.setScore(Score(studentId(i % students), courseId(0), static_cast<double>(i % 101)));
+        });
+
+        // 每次使用不同的（学生, 课程）组合：先全部选课，再按相同顺序全部退课，数据恢复原状
+        auto pair = [&](std::size_t i) { return std::pair{studentId(i % students), courseId(1 + i / students % (BENCH_COURSES - 1))}; };
+        measure("enroll", {{"rows", std::to_string(students)}}, config.reps, [&](std::size_t i) {
+            auto [sid, cid] = pair(i);
+            enrollRepo.enroll(sid, cid);
+        });
+        measure("dropCourse", {{"rows", std::to_string(students)}}, config.reps, [&](std::size_t i) {
+            auto [sid, cid] = pair(i);
+            enrollRepo.dropCourse(sid, cid);
+        });
+
+        for (std::size_t fanout : {std::size_t{0}, std::size_t{10}, BENCH_COURSES}) {
+            // 每次测量前新建一名学生，选fanout门课程并各有一条成绩
+            measure("deleteStudent", {{"fanout", std::to_string(fanout)}}, config.reps, [&](std::size_t i) {
+                auto conn = DBUtil::pool().acquire();
+                auto txn = conn.write();
+                conn.execSql(txn,
+                             "WITH s AS (INSERT INTO students (id, name, major) VALUES ($1, '待删除', '基准测试') RETURNING id), "
+                             "c AS (SELECT id FROM courses ORDER BY id LIMIT $2), "
+                             "e AS (INSERT INTO enrollments (student_id, course_id) SELECT s.id, c.id FROM s, c RETURNING course_id), "
+                             "sc AS (INSERT INTO scores (student_id, course_id, score) SELECT s.id, c.id, 80 FROM s, c) "
+                             "UPDATE courses SET enrolled = enrolled + 1 WHERE id IN (SELECT course_id FROM e)",
+                             std::format("BN-D{:07}", i), static_cast<int>(fanout));
+                conn.commit(txn);
+            }, [&](std::size_t i) { studentRepo.deleteStudent(std::format("BN-D{:07}", i)); });
+        }
+    }
+
+    // 日志存储冷启动：每种规模先由多个线程并发写入学生生成数据文件，再反复打开（重放）计时。
+    // 数据文件在页缓存中，测得的是解码与重建内存索引的耗时，不含磁盘读取
+    void logStorageBenchmarks() {
+        if (!selected("LogStorage::open")) return;
+        const std::string path = (std::filesystem::temp_directory_path() / "student_sys_bench.data").string();
+        for (std::size_t size : config.sizes) {
+            std::filesystem::remove(path);
+            {
+                LogStorage storage(path);
+                std::vector<std::jthread> writers;
+                for (std::size_t w = 0; w < BENCH_LOG_WRITERS; ++w) {
+                    writers.emplace_back([&, w] {
+                        for (std::size_t i = w; i < size; i += BENCH_LOG_WRITERS) {
+                            storage.insertStudent(Student(studentId(i), "基准学生", "计算机科学与技术"));
+                        }
+                    });
+                }
+            }
+            std::optional<LogStorage> storage;
+            measure("LogStorage::open", {{"rows", std::to_string(size)}}, config.scanReps,
+                    [&](std::size_t) { storage.reset(); }, [&](std::size_t) { storage.emplace(path); });
+            storage.reset();
+        }
+        std::filesystem::remove(path);
+    }
+
+    static void appendJson(std::string& out, std::string_view text) {
+        out += '"';
+        for (char ch : text) {
+            if (ch == '"' || ch == '\\') out += '\\';
+            if (static_cast<unsigned char>(ch) < 0x20) out += std::format("\\u{:04x}", static_cast<int>(ch));
+            else out += ch;
+        }
+        out += '"';
+    }
+
+    void writeJson() const {
+        std::string json = "{\n  \"suite\": \"student_sys repositories\",\n";
+        json += std::format("  \"timestamp\": {},\n  \"compiler\": ",
+                            std::chrono::duration_cast<std::chrono::seconds>(
+                                std::chrono::system_clock::now().time_since_epoch()).count());
+        appendJson(json, __VERSION__);
+#ifdef NDEBUG
+        json += ",\n  \"optimized\": true,\n  \"results\": [\n";
+#else
+        json += ",\n  \"optimized\": false,\n  \"results\": [\n";
+#endif
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            json += "    {\"name\": ";
+            appendJson(json, r.name);
+            json += ", \"params\": {";
+            for (std::size_t k = 0; k < r.params.size(); ++k) {
+                if (k) json += ", ";
+                appendJson(json, r.params[k].first);
+                json += ": ";
+                appendJson(json, r.params[k].second);
+            }
+            auto [min, max] = std::ranges::minmax(r.samples);
+            json += std::format("}}, \"warmup\": {}, \"reps\": {}, \"unit\": \"us\", \"mean\": {:.3f}, \"median\": {:.3f}, "
+                                "\"p95\": {:.3f}, \"min\": {:.3f}, \"max\": {:.3f}, \"stddev\": {:.3f}, "
+                                "\"roundTripsPerOp\": {:.2f}, \"allocationsPerOp\": {:.1f}}}{}\n",
+                                r.warmup, r.samples.size(), r.mean(), r.percentile(0.50), r.percentile(0.95), min, max,
+                                r.stddev(), static_cast<double>(r.roundTrips) / r.samples.size(),
+                                static_cast<double>(r.allocations) / r.samples.size(),
+                                i + 1 < results.size() ? "," : "");
+        }
+        json += "  ]\n}\n";
+        std::ofstream file(config.out);
+        if (!file || !(file << json)) throw std::runtime_error("写入结果文件失败：" + config.out);
+    }
+
+public:
+    explicit BenchSuite(BenchConfig config) : config(std::move(config)) {}
+
+    void run() {
+        PostgresStorage::verifySchema();   // 基准schema复制自public，先确认public已执行迁移
+        prepareSchema();
+        // 仓库层的操作提示不输出，进度写到std::clog
+        std::cout.setstate(std::ios::badbit);
+        instrumentationBenchmark();
+        readBenchmarks();
+        writeBenchmarks();
+        logStorageBenchmarks();
+        std::cout.clear();
+        writeJson();
+        std::cout << "基准完成：共 " << results.size() << " 项，结果已写入 " << config.out << '\n';
+    }
+};
+
+// ====================== 单项基准与压测 ======================
+// 以下各项直接在public schema中运行，由命令行的单项模式选择（见runSingle），不写JSON结果
+// 预编译语句基准：对比按SQL文本执行（每次解析+规划）与按名称执行预编译语句的单次调用延迟及往返次数
+class PreparedStatementBenchmark {
+private:
+    struct Sample {
+        double micros;       // 平均单次耗时（微秒）
+        double roundTrips;   // 平均单次往返次数
+    };
+
+    // 预热后计时
+    template<typename Fn>
+    static Sample measure(int iterations, Fn&& fn) {
+        for (int i = 0; i < std::max(1, iterations / 10); ++i) fn();
+        std::uint64_t trips = DBUtil::roundTrips();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) fn();
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        return Sample{micros / iterations, static_cast<double>(DBUtil::roundTrips() - trips) / iterations};
+    }
+
+    static void report(const std::string& op, const Sample& plain, const Sample& prepared) {
+        std::cout << std::left << std::setw(TABLE_WIDTH) << op
+                  << std::setw(TABLE_WIDTH) << std::fixed << std::setprecision(1) << plain.micros
+                  << std::setw(TABLE_WIDTH) << prepared.micros
+                  << std::setw(TABLE_WIDTH) << prepared.roundTrips
+                  << (1.0 - prepared.micros / plain.micros) * 100 << "%\n";
+    }
+
+public:
+    // 成绩写入在事务内执行后回滚，只比较语句执行开销，不修改数据
+    static void run(const std::string& sid, const std::string& cid, int iterations) {
+        auto conn = DBUtil::pool().acquire();
+        {
+            auto txn = conn.read();
+            if (conn.exec(txn, "enrollment_get", sid, cid).empty()) {
+                throw std::runtime_error("学生【" + sid + "】未选课程【" + cid + "】，无法测试成绩录入");
+            }
+        }
+        const std::string getStudentSql(SqlRegistry::get("student_get_by_id"));
+        const std::string setScoreSql(SqlRegistry::get("score_set"));
+        const double score = 60.0;
+
+        Sample getPlain = measure(iterations, [&] {
+            auto txn = conn.read();
+            conn.execSql(txn, getStudentSql, sid);
+        });
+        Sample getPrepared = measure(iterations, [&] {
+            auto txn = conn.read();
+            conn.exec(txn, "student_get_by_id", sid);
+        });
+        Sample setPlain = measure(iterations, [&] {
+            auto txn = conn.write();
+            conn.execSql(txn, setScoreSql, sid, cid, score);
+            conn.rollback(txn);
+        });
+        Sample setPrepared = measure(iterations, [&] {
+            auto txn = conn.write();
+            conn.exec(txn, "score_set", sid, cid, score);
+            conn.rollback(txn);
+        });
+
+        std::cout << "\n=== 预编译语句基准（" << iterations << " 次/项，单位：微秒/次）===\n";
+        std::cout << std::left << std::setw(TABLE_WIDTH) << "操作"
+                  << std::setw(TABLE_WIDTH) << "SQL文本"
+                  << std::setw(TABLE_WIDTH) << "预编译"
+                  << std::setw(TABLE_WIDTH) << "往返/次"
+                  << "降低\n";
+        std::cout << "------------------------------------------------------------\n";
+        report("getStudentById", getPlain, getPrepared);
+        report("setScore", setPlain, setPrepared);
+    }
+};
+
+// 内存目录基准：加载耗时、增量刷新耗时、各实体内存占用及按ID查询延迟
+class CatalogBenchmark {
+private:
+    static void report(const std::string& entity, const CatalogSnapshot::Footprint& f) {
+        std::cout << std::format("{:<10}{:>10}{:>12}{:>12}{:>12}{:>12.1f}\n", entity, f.count, f.textBytes,
+                                 f.columnBytes, f.indexBytes, f.bytesPerEntity());
+    }
+
+    // 对ids中每个ID执行一次查询，返回平均单次耗时（微秒）
+    template<typename Fn>
+    static double lookup(const std::vector<std::string>& ids, int rounds, Fn&& fn) {
+        if (ids.empty()) return 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (const auto& id : ids) fn(id);
+        }
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        return micros / (static_cast<double>(ids.size()) * rounds);
+    }
+
+public:
+    static void run(int rounds) {
+        CatalogSnapshot catalog;
+        auto start = std::chrono::steady_clock::now();
+        std::size_t loaded = catalog.refresh();
+        double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        std::size_t changed = catalog.refresh();
+        double refreshMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<std::string> studentIds, courseIds;
+        for (const auto& s : catalog.getAllStudents()) studentIds.push_back(s.getId());
+        for (const auto& c : catalog.getAllCourses()) courseIds.push_back(c.getId());
+        double studentMicros = lookup(studentIds, rounds, [&](const std::string& id) { catalog.getStudentById(id); });
+        double courseMicros = lookup(courseIds, rounds, [&](const std::string& id) { catalog.getCourseById(id); });
+        // 对照：同一连接上通过数据库查询
+        StudentRepository studentRepo;
+        std::vector<std::string> sample(studentIds.begin(), studentIds.begin() + std::min<std::size_t>(studentIds.size(), 100));
+        double dbMicros = lookup(sample, 1, [&](const std::string& id) { studentRepo.getStudentById(id); });
+
+        auto mem = catalog.memory();
+        std::cout << "\n=== 内存目录 ===\n"
+                  << std::format("全量加载：{}行 {:.2f}ms  增量刷新：{}行 {:.2f}ms  内存池：{}字节\n",
+                                 loaded, loadMs, changed, refreshMs, mem.arenaBytes)
+                  << std::format("{:<10}{:>10}{:>12}{:>12}{:>12}{:>12}\n", "实体", "数量", "文本字节", "列字节", "索引字节", "字节/实体");
+        report("students", mem.students);
+        report("teachers", mem.teachers);
+        report("courses", mem.courses);
+        std::cout << std::format("按ID查询（微秒/次）：学生 {:.3f}  课程 {:.3f}  数据库对照 {:.1f}",
+                                 studentMicros, courseMicros, dbMicros)
+                  << '\n';
+    }
+};
+
+// 选课容量压测：新建两门临时课程和一批临时学生，多个工作线程同时为所有学生选课，
+// 分别在启用名额分配器和仅由数据库判断两种情况下验证选课人数不超过容量、已选人数计数与选课表一致，结束后删除临时数据
+class SeatStressTest {
+private:
+    struct Outcome {
+        std::size_t ok = 0, full = 0, other = 0;
+        double seconds = 0.0;
+    };
+
+    static Outcome rush(const std::vector<std::string>& studentIds, const std::string& courseId, std::size_t workers) {
+        Outcome outcome;
+        RequestExecutor executor(workers);
+        EnrollmentRepository enrollRepo;
+        std::vector<std::future<EnrollResult>> results;
+        results.reserve(studentIds.size());
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& sid : studentIds) {
+            results.push_back(executor.submit([&enrollRepo, &sid, &courseId] { return enrollRepo.enroll(sid, courseId); }));
+        }
+        for (auto& f : results) {
+            try {
+                EnrollResult r = f.get();
+                if (r == EnrollResult::Ok) ++outcome.ok;
+                else if (r == EnrollResult::CourseFull) ++outcome.full;
+                else ++outcome.other;
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << '\n';
+                ++outcome.other;
+            }
+        }
+        outcome.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return outcome;
+    }
+
+    // 校验并打印一轮结果
+    static bool verify(const std::string& mode, const std::string& courseId, int capacity, std::size_t students,
+                       const Outcome& outcome) {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.read();
+        pqxx::row row = conn.exec(txn, "course_seat_check", courseId)[0];
+        auto enrolled = row["enrolled"].as<std::size_t>();
+        auto actual = row["actual"].as<std::size_t>();
+        auto expected = std::min<std::size_t>(capacity, students);
+        bool passed = outcome.ok == expected && actual == expected && enrolled == actual && outcome.other == 0;
+        std::cout << std::format("{:<12}{:>8}{:>8}{:>8}{:>10}{:>10}{:>12.0f}  {}\n", mode, outcome.ok, outcome.full,
+                                 outcome.other, actual, enrolled, students / std::max(outcome.seconds, 1e-9),
+                                 passed ? "通过" : "失败");
+        return passed;
+    }
+
+public:
+    static bool run(const std::string& teacherId, int capacity, std::size_t students, std::size_t workers) {
+        const std::string tag = "STRESS-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count() % 1000000);
+        const std::string memoryCourse = tag + "-MEM", databaseCourse = tag + "-DB";
+        std::vector<std::string> studentIds;
+        studentIds.reserve(students);
+        std::string csv = "id,name,major\n";
+        for (std::size_t i = 0; i < students; ++i) {
+            studentIds.push_back(tag + "-" + std::to_string(i));
+            csv += studentIds.back() + ",压测学生,压测\n";
+        }
+
+        CourseRepository courseRepo;
+        bool passed = false;
+        // 临时数据的提示信息不输出
+        std::cout.setstate(std::ios::badbit);
+        try {
+            TeacherRepository().getTeacherById(teacherId);
+            std::istringstream in(csv);
+            BulkImportRepository().importStudents(in);
+            for (const auto& id : {memoryCourse, databaseCourse}) {
+                courseRepo.addCourse(Course(id, "容量压测", 1, teacherId));
+                courseRepo.setCapacity(id, capacity);
+            }
+
+            SeatAllocator::instance().reconcile();
+            Outcome memory = rush(studentIds, memoryCourse, workers);
+            SeatAllocator::instance().stop();
+            Outcome database = rush(studentIds, databaseCourse, workers);
+
+            std::cout.clear();
+            std::cout << "\n=== 选课容量压测（容量 " << capacity << "，学生 " << students << "，工作线程 " << workers << "）===\n"
+                      << std::format("{:<12}{:>8}{:>8}{:>8}{:>10}{:>10}{:>12}  {}\n", "模式", "成功", "已满", "其他",
+                                     "选课表", "计数", "请求/秒", "结果");
+            passed = verify("名额分配器", memoryCourse, capacity, students, memory);
+            passed = verify("仅数据库", databaseCourse, capacity, students, database) && passed;
+        } catch (const std::exception& e) {
+            std::cout.clear();
+            std::cerr << "压测失败：" << e.what() << '\n';
+        }
+
+        // 清理临时数据
+        std::cout.setstate(std::ios::badbit);
+        try {
+            for (const auto& id : {memoryCourse, databaseCourse}) courseRepo.deleteCourse(id);
+        } catch (const std::exception&) {
+            // 课程可能未创建成功
+        }
+        try {
+            auto conn = DBUtil::pool().acquire();
+            auto txn = conn.write();
+            conn.execSql(txn, "DELETE FROM students WHERE id LIKE $1", tag + "-%");
+            conn.commit(txn);
+        } catch (const std::exception& e) {
+            std::cerr << "清理临时学生失败：" << e.what() << '\n';
+        }
+        std::cout.clear();
+        std::cout << (passed ? "选课人数未超过容量，计数一致" : "压测未通过") << '\n';
+        return passed;
+    }
+};
+
+// 单项模式：第一个参数为--bench-prepared、--catalog-stats或--stress-seats时运行对应项目并返回退出码，否则返回nullopt
+std::optional<int> runSingle(const std::vector<std::string>& args, const char* program) {
+    static const std::unordered_set<std::string> singleModes{"--bench-prepared", "--catalog-stats", "--stress-seats"};
+    if (args.empty() || !singleModes.contains(args[0])) return std::nullopt;
+    try {
+        if (!Storage::current().usesDatabase()) {
+            std::cerr << args[0] << "模式只支持postgres存储后端\n";
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "存储后端初始化失败：" << e.what() << '\n';
+        return 1;
+    }
+    // 基准模式：bench --bench-prepared <学生ID> <课程ID> [次数]
+    if (!args.empty() && args[0] == "--bench-prepared") {
+        if (args.size() < 3) {
+            std::cerr << "用法：" << program << " --bench-prepared <学生ID> <课程ID> [次数]\n";
+            return 1;
+        }
+        try {
+            int iterations = args.size() > 3 ? std::stoi(args[3]) : 1000;
+            PreparedStatementBenchmark::run(args[1], args[2], std::max(1, iterations));
+        } catch (const std::exception& e) {
+            std::cerr << "基准测试失败：" << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    // 内存目录模式：bench --catalog-stats [查询轮数]
+    if (!args.empty() && args[0] == "--catalog-stats") {
+        try {
+            int rounds = args.size() > 1 ? std::stoi(args[1]) : 100;
+            CatalogBenchmark::run(std::max(1, rounds));
+        } catch (const std::exception& e) {
+            std::cerr << "基准测试失败：" << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    // 选课容量压测模式：bench --stress-seats <教师ID> [容量] [学生数] [线程数]
+    if (!args.empty() && args[0] == "--stress-seats") {
+        if (args.size() < 2) {
+            std::cerr << "用法：" << program << " --stress-seats <教师ID> [容量] [学生数] [线程数]\n";
+            return 1;
+        }
+        try {
+            int capacity = args.size() > 2 ? std::stoi(args[2]) : 50;
+            int students = args.size() > 3 ? std::stoi(args[3]) : 500;
+            int workers = args.size() > 4 ? std::stoi(args[4]) : 16;
+            return SeatStressTest::run(args[1], std::max(0, capacity), static_cast<std::size_t>(std::max(1, students)),
+                                       static_cast<std::size_t>(std::max(1, workers))) ? 0 : 1;
+        } catch (const std::exception& e) {
+            std::cerr << "压测失败：" << e.what() << '\n';
+            return 1;
+        }
+    }
+    return std::nullopt;
+}
+
+bool parseArgs(const std::vector<std::string>& args, BenchConfig& config) {
+    auto number = [](std::string_view text, std::size_t& value) {
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && ptr == text.data() + text.size() && value > 0;
+    };
+    for (std::size_t i = 0; i + 1 < args.size(); i += 2) {
+        const std::string& a = args[i];
+        std::string_view v = args[i + 1];
+        if (a == "--out") {
+            config.out = v;
+        } else if (a == "--filter") {
+            config.filter = v;
+        } else if (a == "--warmup") {
+            if (!number(v, config.warmup)) return false;
+        } else if (a == "--reps") {
+            if (!number(v, config.reps)) return false;
+        } else if (a == "--scan-reps") {
+            if (!number(v, config.scanReps)) return false;
+        } else if (a == "--sizes") {
+            config.sizes.clear();
+            for (auto part : std::views::split(v, ',')) {
+                std::size_t size = 0;
+                if (!number(std::string_view(part.begin(), part.end()), size)) return false;
+                config.sizes.push_back(size);
+            }
+        } else {
+            return false;
+        }
+    }
+    return args.size() % 2 == 0;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (auto code = runSingle(args, argv[0])) return *code;
+    BenchConfig config;
+    if (!parseArgs(args, config)) {
+        std::cerr << "用法：" << argv[0] << " [--out 文件.json] [--sizes 1000,100000,1000000] [--warmup N] [--reps N]"
+                  << " [--scan-reps N] [--filter 名称]\n"
+                  << "      " << argv[0] << " --bench-prepared|--catalog-stats|--stress-seats ...\n";
+        return 1;
+    }
+    try {
+        BenchSuite(std::move(config)).run();
+    } catch (const std::exception& e) {
+        std::cout.clear();
+        std::cerr << "基准测试失败：" << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,264 @@
+import std;
+#include <pqxx/pqxx>
+import student_sys;
+
+// ====================== 选课高峰负载生成器 ======================
+// 模拟N个学生并发调用仓库层（选课、退课、录入成绩、查询已选课程），闭环执行：
+// 每个模拟学生完成一次操作、等待思考时间后再发起下一次。课程按Zipf分布取样以模拟热门课程，
+// 结束时按操作汇报吞吐量与延迟分位数。数据集为带LG-前缀的合成数据，可用--seed-data生成、--cleanup删除
+
+// 运行参数
+struct LoadConfig {
+    std::size_t clients = 64;                       // 并发模拟学生数
+    std::chrono::seconds duration{30};              // 压测时长
+    std::chrono::milliseconds thinkTime{0};         // 两次操作之间的思考时间（指数分布的均值）
+    double skew = 1.0;                              // 课程Zipf分布指数，0为均匀
+    std::array<unsigned, 4> mix{40, 20, 20, 20};    // 选课/退课/录入成绩/查询已选课程的权重
+    std::size_t students = 10000;                   // 合成学生数
+    std::size_t courses = 200;                      // 合成课程数
+    std::size_t enrollmentsPerStudent = 4;          // 生成数据时每个学生预选的课程数
+    std::uint64_t seed = 42;
+    bool seedData = false;
+    bool cleanup = false;
+};
+
+enum class Operation { Enroll, Drop, SetScore, ListCourses };
+constexpr std::array<std::string_view, 4> OPERATION_NAMES{"enroll", "dropCourse", "setScore", "getEnrolledCourses"};
+
+// 合成数据集的ID规则
+std::string studentId(std::size_t i) { return std::format("LG-S{:07}", i); }
+std::string courseId(std::size_t i) { return std::format("LG-C{:05}", i); }
+
+// Zipf分布取样：预先计算累积分布，取样时二分查找；下标0为最热门
+class ZipfSampler {
+private:
+    std::vector<double> cdf;
+public:
+    ZipfSampler(std::size_t n, double s) : cdf(n) {
+        double sum = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+            cdf[i] = sum;
+        }
+        for (auto& c : cdf) c /= sum;
+    }
+
+    template<typename Rng>
+    std::size_t operator()(Rng& rng) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        return std::min<std::size_t>(std::ranges::lower_bound(cdf, u) - cdf.begin(), cdf.size() - 1);
+    }
+};
+
+// 单个操作的统计：各线程各自记录，结束后合并
+struct OperationStats {
+    std::vector<double> latencies;   // 微秒
+    std::size_t failed = 0;          // 业务拒绝或异常
+
+    void merge(OperationStats&& other) {
+        latencies.insert(latencies.end(), other.latencies.begin(), other.latencies.end());
+        failed += other.failed;
+    }
+};
+
+using ClientStats = std::array<OperationStats, 4>;
+
+// 生成合成数据集：教师、课程、学生经COPY导入，预选课程由一条INSERT...SELECT生成
+void seedDataset(const LoadConfig& config) {
+    BulkImportRepository importRepo;
+    std::string csv = "id,name,department\nLG-T00001,负载教师,负载测试\n";
+    std::istringstream teachers(csv);
+    importRepo.importTeachers(teachers);
+
+    csv = "id,name,credit,teacher_id\n";
+    for (std::size_t i = 0; i < config.courses; ++i) csv += courseId(i) + ",负载课程," + std::to_string(1 + i % 5) + ",LG-T00001\n";
+    std::istringstream courses(csv);
+    auto courseResult = importRepo.importCourses(courses);
+
+    csv = "id,name,major\n";
+    for (std::size_t i = 0; i < config.students; ++i) csv += studentId(i) + ",负载学生,负载测试\n";
+    std::istringstream students(csv);
+    auto studentResult = importRepo.importStudents(students);
+
+    auto conn = DBUtil::pool().acquire();
+    auto txn = conn.write();
+    conn.execSql(txn, "INSERT INTO enrollments (student_id, course_id) "
+                      "SELECT s.id, c.id FROM students s CROSS JOIN LATERAL "
+                      "(SELECT id FROM courses WHERE id LIKE 'LG-C%' AND s.id IS NOT NULL ORDER BY random() LIMIT $1) c "
+                      "WHERE s.id LIKE 'LG-S%' ON CONFLICT DO NOTHING",
+                 static_cast<int>(config.enrollmentsPerStudent));
+    conn.execSql(txn, "UPDATE courses c SET enrolled = (SELECT count(*) FROM enrollments e WHERE e.course_id = c.id) "
+                      "WHERE c.id LIKE 'LG-C%'");
+    conn.commit(txn);
+    std::cout << "合成数据已生成：课程新增 " << courseResult.inserted << " 门，学生新增 " << studentResult.inserted
+              << " 名，每名学生预选 " << config.enrollmentsPerStudent << " 门课程\n";
+}
+
+void cleanupDataset() {
+    auto conn = DBUtil::pool().acquire();
+    auto txn = conn.write();
+    conn.execSql(txn, "DELETE FROM scores WHERE student_id LIKE 'LG-S%' OR course_id LIKE 'LG-C%'");
+    conn.execSql(txn, "DELETE FROM enrollments WHERE student_id LIKE 'LG-S%' OR course_id LIKE 'LG-C%'");
+    conn.execSql(txn, "DELETE FROM courses WHERE id LIKE 'LG-C%'");
+    conn.execSql(txn, "DELETE FROM students WHERE id LIKE 'LG-S%'");
+    conn.execSql(txn, "DELETE FROM teachers WHERE id = 'LG-T00001'");
+    conn.commit(txn);
+    std::cout << "合成数据已删除\n";
+}
+
+// 一个模拟学生的闭环：直到deadline前不断按权重选择操作并计时
+ClientStats runClient(const LoadConfig& config, const ZipfSampler& zipf, std::size_t client,
+                      std::chrono::steady_clock::time_point deadline) {
+    ClientStats stats;
+    std::mt19937_64 rng(config.seed + client);
+    std::discrete_distribution<int> pickOperation(config.mix.begin(), config.mix.end());
+    std::uniform_int_distribution<std::size_t> pickStudent(0, config.students - 1);
+    std::uniform_real_distribution<double> pickScore(0.0, 100.0);
+    std::exponential_distribution<double> think(config.thinkTime.count() > 0 ? 1.0 / config.thinkTime.count() : 1.0);
+    EnrollmentRepository enrollRepo;
+    ScoreRepository scoreRepo;
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        auto op = static_cast<Operation>(pickOperation(rng));
+        std::string sid = studentId(pickStudent(rng));
+        std::string cid = courseId(zipf(rng));
+        bool ok = true;
+        auto start = std::chrono::steady_clock::now();
+        try {
+            switch (op) {
+                case Operation::Enroll: ok = enrollRepo.enroll(sid, cid) == EnrollResult::Ok; break;
+                case Operation::Drop: enrollRepo.dropCourse(sid, cid); break;
+                case Operation::SetScore: ok = scoreRepo.setScore(Score(sid, cid, pickScore(rng))) == ScoreResult::Ok; break;
+                case Operation::ListCourses: enrollRepo.getEnrolledCourses(sid); break;
+            }
+        } catch (const std::exception&) {
+            ok = false;
+        }
+        auto& s = stats[static_cast<std::size_t>(op)];
+        s.latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        if (!ok) ++s.failed;
+        if (config.thinkTime.count() > 0) {
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(think(rng)));
+        }
+    }
+    return stats;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    auto rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+
+void report(const LoadConfig& config, ClientStats& total, double seconds) {
+    std::cout << std::format("\n=== 负载测试：{}个并发学生，{:.1f}s，思考时间{}ms，Zipf指数{:.2f} ===\n",
+                             config.clients, seconds, config.thinkTime.count(), config.skew)
+              << std::format("{:<20}{:>10}{:>8}{:>10}{:>10}{:>10}{:>10}{:>10}\n", "操作", "次数", "失败", "次/秒",
+                             "p50(ms)", "p95(ms)", "p99(ms)", "p999(ms)");
+    std::size_t all = 0;
+    for (std::size_t i = 0; i < total.size(); ++i) {
+        auto& lat = total[i].latencies;
+        std::ranges::sort(lat);
+        all += lat.size();
+        std::cout << std::format("{:<20}{:>10}{:>8}{:>10.0f}{:>10.2f}{:>10.2f}{:>10.2f}{:>10.2f}\n", OPERATION_NAMES[i],
+                                 lat.size(), total[i].failed, lat.size() / seconds, percentile(lat, 0.50) / 1000,
+                                 percentile(lat, 0.95) / 1000, percentile(lat, 0.99) / 1000,
+                                 percentile(lat, 0.999) / 1000);
+    }
+    std::cout << std::format("合计吞吐：{:.0f} 次/秒", all / seconds) << '\n';
+}
+
+void usage(const char* prog) {
+    std::cerr << "用法：" << prog << " [--clients N] [--duration 秒] [--think 毫秒] [--skew S]\n"
+              << "       [--mix 选课,退课,成绩,查询] [--students N] [--courses N] [--seed N]\n"
+              << "       [--seed-data [--enrollments N]] [--cleanup]\n";
+}
+
+// 解析无符号整数参数
+template<typename T>
+bool parseArg(std::string_view text, T& value) {
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+bool parseArgs(const std::vector<std::string>& args, LoadConfig& config) {
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        const std::string& a = args[i];
+        if (a == "--seed-data") { config.seedData = true; continue; }
+        if (a == "--cleanup") { config.cleanup = true; continue; }
+        if (i + 1 >= args.size()) return false;
+        std::string_view v = args[++i];
+        bool ok = true;
+        std::size_t n = 0;
+        if (a == "--clients") ok = parseArg(v, config.clients) && config.clients > 0;
+        else if (a == "--duration") {
+            ok = parseArg(v, n) && n > 0;
+            config.duration = std::chrono::seconds(n);
+        } else if (a == "--think") {
+            ok = parseArg(v, n);
+            config.thinkTime = std::chrono::milliseconds(n);
+        } else if (a == "--skew") ok = parseArg(v, config.skew) && config.skew >= 0;
+        else if (a == "--students") ok = parseArg(v, config.students) && config.students > 0;
+        else if (a == "--courses") ok = parseArg(v, config.courses) && config.courses > 0;
+        else if (a == "--enrollments") ok = parseArg(v, config.enrollmentsPerStudent);
+        else if (a == "--seed") ok = parseArg(v, config.seed);
+        else if (a == "--mix") {
+            std::size_t k = 0;
+            for (auto part : std::views::split(v, ',')) {
+                if (k >= config.mix.size()) return false;
+                ok = ok && parseArg(std::string_view(part.begin(), part.end()), config.mix[k++]);
+            }
+            ok = ok && k == config.mix.size() && std::ranges::any_of(config.mix, [](unsigned w) { return w > 0; });
+        } else {
+            return false;
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig config;
+    if (!parseArgs(std::vector<std::string>(argv + 1, argv + argc), config)) {
+        usage(argv[0]);
+        return 1;
+    }
+    try {
+        if (config.cleanup) {
+            cleanupDataset();
+            return 0;
+        }
+        PostgresStorage::verifySchema();   // 生成数据与选课都依赖courses.capacity/enrolled
+        if (config.seedData) seedDataset(config);
+        // 压测期间可按STUDENT_SYS_TRACE记录SQL跟踪，定位慢语句
+        if (auto trace = SqlTrace::configFromEnv()) SqlTrace::instance().enable(std::move(*trace));
+
+        // 仓库层的操作提示不输出
+        std::cout.setstate(std::ios::badbit);
+        ZipfSampler zipf(config.courses, config.skew);
+        std::vector<std::future<ClientStats>> clients;
+        clients.reserve(config.clients);
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + config.duration;
+        {
+            // 每个模拟学生占用一个工作线程及其独占连接
+            RequestExecutor executor(config.clients);
+            for (std::size_t i = 0; i < config.clients; ++i) {
+                clients.push_back(executor.submit([&, i] { return runClient(config, zipf, i, deadline); }));
+            }
+            ClientStats total;
+            for (auto& f : clients) {
+                ClientStats stats = f.get();
+                for (std::size_t k = 0; k < total.size(); ++k) total[k].merge(std::move(stats[k]));
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout.clear();
+            report(config, total, seconds);
+        }
+    } catch (const std::exception& e) {
+        std::cout.clear();
+        std::cerr << "负载测试失败：" << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
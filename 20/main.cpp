@@ -1,652 +1,357 @@
 import std;
 #include <pqxx/pqxx>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+import student_sys;
 
+// 服务模式参数
+const std::uint16_t HTTP_PORT = 8080; // 服务模式默认监听端口（仅本机）
+const std::size_t HTTP_MAX_INFLIGHT = 1024; // 服务模式同时执行中的请求上限，超出返回503
+const std::size_t HTTP_MAX_REQUEST_BYTES = 64 * 1024; // 单个请求（请求头+请求体）的最大字节数
 
-// 全局常量：封装数据库连接参数，避免硬编码
-const std::string DB_CONN_STR = "dbname=student_sys user=postgres password=123456 host=localhost port=5432";
-const int TABLE_WIDTH = 15; // 格式化输出列宽
-
-// ====================== 领域层（实体类）======================
-class Student {
-private:
-    std::string id;
-    std::string name;
-    std::string major;
-public:
-    Student(std::string id, std::string name, std::string major)
-        : id(std::move(id)), name(std::move(name)), major(std::move(major)) {}
-
-    std::string getId() const { return id; }
-    std::string getName() const { return name; }
-    std::string getMajor() const { return major; }
-};
-
-class Teacher {
-private:
-    std::string id;
-    std::string name;
-    std::string department;
-public:
-    Teacher(std::string id, std::string name, std::string department)
-        : id(std::move(id)), name(std::move(name)), department(std::move(department)) {}
-
-    std::string getId() const { return id; }
-    std::string getName() const { return name; }
-    std::string getDepartment() const { return department; }
-};
-
-class Course {
-private:
-    std::string id;
-    std::string name;
-    int credit;
-    std::string teacherId;
-public:
-    Course(std::string id, std::string name, int credit, std::string teacherId)
-        : id(std::move(id)), name(std::move(name)), credit(credit), teacherId(std::move(teacherId)) {}
-
-    std::string getId() const { return id; }
-    std::string getName() const { return name; }
-    int getCredit() const { return credit; }
-    std::string getTeacherId() const { return teacherId; }
-};
-
-class Score {
-private:
-    std::string studentId;
-    std::string courseId;
-    double score;
-public:
-    Score(std::string studentId, std::string courseId, double score)
-        : studentId(std::move(studentId)), courseId(std::move(courseId)), score(score) {}
-
-    std::string getStudentId() const { return studentId; }
-    std::string getCourseId() const { return courseId; }
-    double getScore() const { return score; }
-    void setScore(double s) { score = s; }
-};
-
-// ====================== 工具类：数据库连接+输入处理 ======================
-// 数据库连接工具：封装连接创建，避免重复代码
-class DBUtil {
-public:
-    static pqxx::connection createConn() {
-        try {
-            pqxx::connection conn(DB_CONN_STR);
-            if (conn.is_open()) {
-                return conn;
-            } else {
-                throw std::runtime_error("数据库连接失败：连接未打开");
-            }
-        } catch (const pqxx::sql_error& e) {
-            throw std::runtime_error("SQL错误：" + std::string(e.what()) + " | SQL：" + e.query());
-        } catch (const std::exception& e) {
-            throw std::runtime_error("数据库连接错误：" + std::string(e.what()));
-        }
-    }
-};
-
-// 输入处理工具：处理cin异常，避免死循环
-class InputUtil {
-public:
-    // 清空输入缓冲区
-    static void clearInput() {
-        std::cin.clear();
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    }
-
-    // 读取整数（带范围校验）
-    static int readInt(int min, int max) {
-        int num;
-        while (true) {
-            if (std::cin >> num && num >= min && num <= max) {
-                clearInput();
-                return num;
-            } else {
-                clearInput();
-                std::cout << "输入无效，请输入" << min << "-" << max << "之间的整数：";
-            }
-        }
-    }
-
-    // 读取字符串（非空校验）
-    static std::string readString(const std::string& tip) {
-        std::string str;
-        while (true) {
-            std::cout << tip;
-            std::cin >> str;
-            if (!str.empty()) {
-                return str;
-            }
-            std::cout << "输入不能为空！" << std::endl;
-        }
-    }
-
-    // 读取浮点数（0-100范围，成绩专用）
-    static double readScore() {
-        double s;
-        while (true) {
-            std::cout << "输入成绩（0-100）：";
-            if (std::cin >> s && s >= 0 && s <= 100) {
-                clearInput();
-                return s;
-            } else {
-                clearInput();
-                std::cout << "成绩无效，请输入0-100的数字！" << std::endl;
-            }
-        }
-    }
-};
-
-// ====================== 数据管理层（仓库层）======================
-class StudentRepository {
+// ====================== 应用逻辑层（控制器）======================
+// 每个操作分为两层：带参数的版本执行业务并返回是否成功（供批量模式等非交互调用），
+// 无参数的版本读取终端输入后调用前者。输出使用'\n'而非std::endl，交互模式下由cin的tie在读取前刷新
+class StudentController {
 private:
-    pqxx::connection conn;
+    StudentRepository studentRepo;
 public:
-    StudentRepository() : conn(DBUtil::createConn()) {}
-
-    // 新增学生
-    void addStudent(const Student& student) {
+    bool addStudent(const std::string& id, const std::string& name, const std::string& major) {
+        OperationTimer timer;
         try {
-            pqxx::work txn(conn);
-            txn.exec_params(
-                "INSERT INTO students (id, name, major) VALUES ($1, $2, $3) ON CONFLICT (id) DO NOTHING",
-                student.getId(), student.getName(), student.getMajor()
-            );
-            txn.commit();
-            std::cout << "学生【" << student.getName() << "】新增成功！" << std::endl;
-        } catch (const std::exception& e) {
-            throw std::runtime_error("新增学生失败：" + std::string(e.what()));
-        }
-    }
-
-    // 根据ID查询学生
-    Student getStudentById(const std::string& id) {
-        try {
-            pqxx::work txn(conn);
-            pqxx::result res = txn.exec_params("SELECT * FROM students WHERE id = $1", id);
-            txn.commit();
-            if (res.empty()) throw std::runtime_error("学生ID【" + id + "】不存在");
-            return Student(
-                res[0]["id"].as<std::string>(),
-                res[0]["name"].as<std::string>(),
-                res[0]["major"].as<std::string>()
-            );
+            studentRepo.addStudent(Student(id, name, major));
+            return true;
         } catch (const std::exception& e) {
-            throw std::runtime_error("查询学生失败：" + std::string(e.what()));
+            std::cerr << e.what() << '\n';
+            timer.fail();
+            return false;
         }
     }
 
-    // 查询所有学生
-    std::vector<Student> getAllStudents() {
-        try {
-            pqxx::work txn(conn);
-            pqxx::result res = txn.exec("SELECT * FROM students ORDER BY id");
-            txn.commit();
-            std::vector<Student> students;
-            for (const auto& row : res) {
-                students.emplace_back(
-                    row["id"].as<std::string>(),
-                    row["name"].as<std::string>(),
-                    row["major"].as<std::string>()
-                );
-            }
-            return students;
-        } catch (const std::exception& e) {
-            throw std::runtime_error("查询所有学生失败：" + std::string(e.what()));
-        }
+    void addStudent() {
+        std::string id = InputUtil::readString("输入学生ID：");
+        std::string name = InputUtil::readString("输入学生姓名：");
+        std::string major = InputUtil::readString("输入学生专业：");
+        addStudent(id, name, major);
     }
 
-    // 删除学生
-    void deleteStudent(const std::string& id) {
+    bool deleteStudent(const std::string& id) {
+        OperationTimer timer;
         try {
-            // 先校验学生是否存在
-            getStudentById(id);
-            pqxx::work txn(conn);
-            // 级联删除选课和成绩记录
-            txn.exec_params("DELETE FROM scores WHERE student_id = $1", id);
-            txn.exec_params("DELETE FROM enrollments WHERE student_id = $1", id);
-            txn.exec_params("DELETE FROM students WHERE id = $1", id);
-            txn.commit();
-            std::cout << "学生ID【" << id << "】删除成功（含关联选课/成绩）！" << std::endl;
+            studentRepo.deleteStudent(id);
+            return true;
         } catch (const std::exception& e) {
-            throw std::runtime_error("删除学生失败：" + std::string(e.what()));
+            std::cerr << e.what() << '\n';
+            timer.fail();
+            return false;
         }
     }
-};
-
-class TeacherRepository {
-private:
-    pqxx::connection conn;
-public:
-    TeacherRepository() : conn(DBUtil::createConn()) {}
 
-    // 新增教师
-    void addTeacher(const Teacher& teacher) {
-        try {
-            pqxx::work txn(conn);
-            txn.exec_params(
-                "INSERT INTO teachers (id, name, department) VALUES ($1, $2, $3) ON CONFLICT (id) DO NOTHING",
-                teacher.getId(), teacher.getName(), teacher.getDepartment()
-            );
-            txn.commit();
-            std::cout << "教师【" << teacher.getName() << "】新增成功！" << std::endl;
-        } catch (const std::exception& e) {
-            throw std::runtime_error("新增教师失败：" + std::string(e.what()));
-        }
+    void deleteStudent() {
+        deleteStudent(InputUtil::readString("输入要删除的学生ID："));
     }
 
-    // 根据ID查询教师
-    Teacher getTeacherById(const std::string& id) {
+    bool listAllStudents() {
         try {
-            pqxx::work txn(conn);
-            pqxx::result res = txn.exec_params("SELECT * FROM teachers WHERE id = $1", id);
-            txn.commit();
-            if (res.empty()) throw std::runtime_error("教师ID【" + id + "】不存在");
-            return Teacher(
-                res[0]["id"].as<std::string>(),
-                res[0]["name"].as<std::string>(),
-                res[0]["department"].as<std::string>()
-            );
+            // 边拉取边打印，不在内存中保留整张表
+            TableRenderer table({"学生ID", "姓名", "专业"});
+            table.line("\n=== 所有学生列表 ===");
+            table.header();
+            studentRepo.forEachStudent([&](const Student& s) {
+                table.row(s.getId(), s.getName(), s.getMajor());
+            });
+            return true;
         } catch (const std::exception& e) {
-            throw std::runtime_error("查询教师失败：" + std::string(e.what()));
+            std::cerr << e.what() << '\n';
+            return false;
         }
     }
 };
 
-class CourseRepository {
+class CourseController {
 private:
-    pqxx::connection conn;
+    CourseRepository courseRepo;
+    TeacherRepository teacherRepo;
+    StudentRepository studentRepo;
+    EnrollmentRepository enrollRepo;
 public:
-    CourseRepository() : conn(DBUtil::createConn()) {}
-
-    // 新增课程
-    void addCourse(const Course& course) {
+    bool addCourse(const std::string& id, const std::string& name, int credit, const std::string& tid) {
+        OperationTimer timer;
         try {
-            pqxx::work txn(conn);
-            txn.exec_params(
-                "INSERT INTO courses (id, name, credit, teacher_id) VALUES ($1, $2, $3, $4) ON CONFLICT (id) DO NOTHING",
-                course.getId(), course.getName(), course.getCredit(), course.getTeacherId()
-            );
-            txn.commit();
-            std::cout << "课程【" << course.getName() << "】新增成功！" << std::endl;
+            // 校验教师是否存在
+            teacherRepo.getTeacherById(tid);
+            courseRepo.addCourse(Course(id, name, credit, tid));
+            return true;
         } catch (const std::exception& e) {
-            throw std::runtime_error("新增课程失败：" + std::string(e.what()));
+            std::cerr << e.what() << '\n';
+            timer.fail();
+            return false;
         }
     }
 
-    // 根据ID查询课程
-    Course getCourseById(const std::string& id) {
-        try {
-            pqxx::work txn(conn);
-            pqxx::result res = txn.exec_params("SELECT * FROM courses WHERE id = $1", id);
-            txn.commit();
-            if (res.empty()) throw std::runtime_error("课程ID【" + id + "】不存在");
-            return Course(
-                res[0]["id"].as<std::string>(),
-                res[0]["name"].as<std::string>(),
-                res[0]["credit"].as<int>(),
-                res[0]["teacher_id"].as<std::string>()
-            );
-        } catch (const std::exception& e) {
-            throw std::runtime_error("查询课程失败：" + std::string(e.what()));
-        }
+    void addCourse() {
+        std::string id = InputUtil::readString("输入课程ID：");
+        std::string name = InputUtil::readString("输入课程名称：");
+        std::cout << "输入课程学分：";
+        int credit = InputUtil::readInt(1, 10);
+        std::string tid = InputUtil::readString("输入授课教师ID：");
+        addCourse(id, name, credit, tid);
     }
 
-    // 查询所有课程
-    std::vector<Course> getAllCourses() {
+    // chunkSize大于0时分批删除，见CourseRepository::deleteCourse
+    bool deleteCourse(const std::string& id, std::size_t chunkSize = 0) {
+        OperationTimer timer;
         try {
-            pqxx::work txn(conn);
-            pqxx::result res = txn.exec("SELECT * FROM courses ORDER BY id");
-            txn.commit();
-            std::vector<Course> courses;
-            for (const auto& row : res) {
-                courses.emplace_back(
-                    row["id"].as<std::string>(),
-                    row["name"].as<std::string>(),
-                    row["credit"].as<int>(),
-                    row["teacher_id"].as<std::string>()
-                );
-            }
-            return courses;
+            courseRepo.deleteCourse(id, chunkSize);
+            return true;
         } catch (const std::exception& e) {
-            throw std::runtime_error("查询所有课程失败：" + std::string(e.what()));
+            std::cerr << e.what() << '\n';
+            timer.fail();
+            return false;
         }
     }
 
-    // 删除课程
-    void deleteCourse(const std::string& id) {
-        try {
-            getCourseById(id);
-            pqxx::work txn(conn);
-            txn.exec_params("DELETE FROM scores WHERE course_id = $1", id);
-            txn.exec_params("DELETE FROM enrollments WHERE course_id = $1", id);
-            txn.exec_params("DELETE FROM courses WHERE id = $1", id);
-            txn.commit();
-            std::cout << "课程ID【" << id << "】删除成功（含关联选课/成绩）！" << std::endl;
-        } catch (const std::exception& e) {
-            throw std::runtime_error("删除课程失败：" + std::string(e.what()));
-        }
+    void deleteCourse() {
+        deleteCourse(InputUtil::readString("输入要删除的课程ID："));
     }
-};
-
-class ScoreRepository {
-private:
-    pqxx::connection conn;
-public:
-    ScoreRepository() : conn(DBUtil::createConn()) {}
 
-    // 录入/更新成绩
-    void setScore(const Score& score) {
+    bool listAllCourses() {
         try {
-            pqxx::work txn(conn);
-            // 先校验是否选课
-            pqxx::result res = txn.exec_params(
-                "SELECT * FROM enrollments WHERE student_id = $1 AND course_id = $2",
-                score.getStudentId(), score.getCourseId()
-            );
-            if (res.empty()) throw std::runtime_error("学生未选该课程，无法录入成绩");
-            // 存在则更新，不存在则插入
-            txn.exec_params(
-                "INSERT INTO scores (student_id, course_id, score) VALUES ($1, $2, $3) "
-                "ON CONFLICT (student_id, course_id) DO UPDATE SET score = $3",
-                score.getStudentId(), score.getCourseId(), score.getScore()
-            );
-            txn.commit();
-            std::cout << "成绩录入/更新成功！" << std::endl;
+            TableRenderer table({"课程ID", "课程名称", "学分"});
+            table.line("\n=== 所有课程列表 ===");
+            table.header();
+            courseRepo.forEachCourse([&](const Course& c) {
+                table.row(c.getId(), c.getName(), c.getCredit());
+            });
+            return true;
         } catch (const std::exception& e) {
-            throw std::runtime_error("成绩操作失败：" + std::string(e.what()));
+            std::cerr << e.what() << '\n';
+            return false;
         }
     }
 
-    // 查询学生所有成绩
-    std::vector<Score> getScoresByStudentId(const std::string& studentId) {
+    bool setCapacity(const std::string& id, std::optional<int> capacity) {
+        OperationTimer timer;
         try {
-            pqxx::work txn(conn);
-            pqxx::result res = txn.exec_params(
-                "SELECT * FROM scores WHERE student_id = $1 ORDER BY course_id",
-                studentId
-            );
-            txn.commit();
-            std::vector<Score> scores;
-            for (const auto& row : res) {
-                scores.emplace_back(
-                    row["student_id"].as<std::string>(),
-                    row["course_id"].as<std::string>(),
-                    row["score"].as<double>()
-                );
-            }
-            if (scores.empty()) throw std::runtime_error("该学生暂无成绩记录");
-            return scores;
+            courseRepo.setCapacity(id, capacity);
+            return true;
         } catch (const std::exception& e) {
-            throw std::runtime_error("查询成绩失败：" + std::string(e.what()));
+            std::cerr << e.what() << '\n';
+            timer.fail();
+            return false;
         }
     }
-};
 
-class EnrollmentRepository {
-private:
-    pqxx::connection conn;
-public:
-    EnrollmentRepository() : conn(DBUtil::createConn()) {}
-
-    // 选课（含重复校验）
-    void enroll(const std::string& studentId, const std::string& courseId) {
+    bool enrollStudent(const std::string& sid, const std::string& cid) {
+        OperationTimer timer;
         try {
-            pqxx::work txn(conn);
-            // 校验是否已选课
-            pqxx::result res = txn.exec_params(
-                "SELECT * FROM enrollments WHERE student_id = $1 AND course_id = $2",
-                studentId, courseId
-            );
-            if (!res.empty()) throw std::runtime_error("已选该课程，无需重复选课");
-            // 插入选课记录
-            txn.exec_params(
-                "INSERT INTO enrollments (student_id, course_id) VALUES ($1, $2)",
-                studentId, courseId
-            );
-            txn.commit();
-            std::cout << "学生【" << studentId << "】选课【" << courseId << "】成功！" << std::endl;
+            EnrollResult result = enrollRepo.enroll(sid, cid);
+            (result == EnrollResult::Ok ? std::cout : std::cerr) << describe(result, sid, cid) << '\n';
+            if (result != EnrollResult::Ok) timer.fail();
+            return result == EnrollResult::Ok;
         } catch (const std::exception& e) {
-            throw std::runtime_error("选课失败：" + std::string(e.what()));
+            std::cerr << e.what() << '\n';
+            timer.fail();
+            return false;
         }
     }
 
-    // 退课
-    void dropCourse(const std::string& studentId, const std::string& courseId) {
-        try {
-            pqxx::work txn(conn);
-            pqxx::result res = txn.exec_params(
-                "SELECT * FROM enrollments WHERE student_id = $1 AND course_id = $2",
-                studentId, courseId
-            );
-            if (res.empty()) throw std::runtime_error("未选该课程，无法退课");
-            // 级联删除成绩
-            txn.exec_params("DELETE FROM scores WHERE student_id = $1 AND course_id = $2", studentId, courseId);
-            txn.exec_params("DELETE FROM enrollments WHERE student_id = $1 AND course_id = $2", studentId, courseId);
-            txn.commit();
-            std::cout << "学生【" << studentId << "】退课【" << courseId << "】成功！" << std::endl;
-        } catch (const std::exception& e) {
-            throw std::runtime_error("退课失败：" + std::string(e.what()));
-        }
+    void enrollStudent() {
+        std::string sid = InputUtil::readString("输入学生ID：");
+        std::string cid = InputUtil::readString("输入课程ID：");
+        enrollStudent(sid, cid);
     }
 
-    // 查询学生已选课程
-    std::vector<Course> getEnrolledCourses(const std::string& studentId, CourseRepository& courseRepo) {
+    bool dropStudentCourse(const std::string& sid, const std::string& cid) {
+        OperationTimer timer;
         try {
-            pqxx::work txn(conn);
-            pqxx::result res = txn.exec_params(
-                "SELECT course_id FROM enrollments WHERE student_id = $1 ORDER BY course_id",
-                studentId
-            );
-            txn.commit();
-            std::vector<Course> courses;
-            for (const auto& row : res) {
-                std::string cid = row["course_id"].as<std::string>();
-                courses.push_back(courseRepo.getCourseById(cid));
-            }
-            if (courses.empty()) throw std::runtime_error("该学生暂无选课记录");
-            return courses;
+            enrollRepo.dropCourse(sid, cid);
+            return true;
         } catch (const std::exception& e) {
-            throw std::runtime_error("查询选课记录失败：" + std::string(e.what()));
+            std::cerr << e.what() << '\n';
+            timer.fail();
+            return false;
         }
     }
-};
 
-// ====================== 应用逻辑层（控制器）======================
-class StudentController {
-private:
-    StudentRepository studentRepo;
-public:
-    void addStudent() {
-        std::string id = InputUtil::readString("输入学生ID：");
-        std::string name = InputUtil::readString("输入学生姓名：");
-        std::string major = InputUtil::readString("输入学生专业：");
-        try {
-            studentRepo.addStudent(Student(id, name, major));
-        } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
-        }
+    void dropStudentCourse() {
+        std::string sid = InputUtil::readString("输入学生ID：");
+        std::string cid = InputUtil::readString("输入课程ID：");
+        dropStudentCourse(sid, cid);
     }
 
-    void deleteStudent() {
-        std::string id = InputUtil::readString("输入要删除的学生ID：");
+    bool listStudentCourses(const std::string& sid) {
+        OperationTimer timer;
         try {
-            studentRepo.deleteStudent(id);
+            studentRepo.getStudentById(sid);
+            auto courses = enrollRepo.getEnrolledCourses(sid);
+            TableRenderer table({"课程ID", "课程名称", "学分"});
+            table.line("\n=== 学生【" + sid + "】已选课程 ===");
+            table.header();
+            for (const auto& c : courses) {
+                table.row(c.getId(), c.getName(), c.getCredit());
+            }
+            return true;
         } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
+            std::cerr << e.what() << '\n';
+            timer.fail();
+            return false;
         }
     }
 
-    void listAllStudents() {
-        try {
-            auto students = studentRepo.getAllStudents();
-            std::cout << "\n=== 所有学生列表 ===" << std::endl;
-            std::cout << std::left << std::setw(TABLE_WIDTH) << "学生ID"
-                      << std::setw(TABLE_WIDTH) << "姓名"
-                      << std::setw(TABLE_WIDTH) << "专业" << std::endl;
-            std::cout << "---------------------------------------------" << std::endl;
-            for (const auto& s : students) {
-                std::cout << std::left << std::setw(TABLE_WIDTH) << s.getId()
-                          << std::setw(TABLE_WIDTH) << s.getName()
-                          << std::setw(TABLE_WIDTH) << s.getMajor() << std::endl;
-            }
-        } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
-        }
+    void listStudentCourses() {
+        listStudentCourses(InputUtil::readString("输入学生ID："));
     }
 };
 
-class CourseController {
+class TeacherController {
 private:
-    CourseRepository courseRepo;
     TeacherRepository teacherRepo;
-    StudentRepository studentRepo;
-    EnrollmentRepository enrollRepo;
 public:
-    void addCourse() {
-        std::string id = InputUtil::readString("输入课程ID：");
-        std::string name = InputUtil::readString("输入课程名称：");
-        std::cout << "输入课程学分：";
-        int credit = InputUtil::readInt(1, 10);
-        std::string tid = InputUtil::readString("输入授课教师ID：");
+    bool addTeacher(const std::string& id, const std::string& name, const std::string& dept) {
+        OperationTimer timer;
         try {
-            // 校验教师是否存在
-            teacherRepo.getTeacherById(tid);
-            courseRepo.addCourse(Course(id, name, credit, tid));
-        } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
-        }
-    }
-
-    void deleteCourse() {
-        std::string id = InputUtil::readString("输入要删除的课程ID：");
-        try {
-            courseRepo.deleteCourse(id);
+            teacherRepo.addTeacher(Teacher(id, name, dept));
+            return true;
         } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
+            std::cerr << e.what() << '\n';
+            timer.fail();
+            return false;
         }
     }
 
-    void listAllCourses() {
-        try {
-            auto courses = courseRepo.getAllCourses();
-            std::cout << "\n=== 所有课程列表 ===" << std::endl;
-            std::cout << std::left << std::setw(TABLE_WIDTH) << "课程ID"
-                      << std::setw(TABLE_WIDTH) << "课程名称"
-                      << std::setw(TABLE_WIDTH) << "学分" << std::endl;
-            std::cout << "---------------------------------------------" << std::endl;
-            for (const auto& c : courses) {
-                std::cout << std::left << std::setw(TABLE_WIDTH) << c.getId()
-                          << std::setw(TABLE_WIDTH) << c.getName()
-                          << std::setw(TABLE_WIDTH) << c.getCredit() << std::endl;
-            }
-        } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
-        }
+    void addTeacher() {
+        std::string id = InputUtil::readString("输入教师ID：");
+        std::string name = InputUtil::readString("输入教师姓名：");
+        std::string dept = InputUtil::readString("输入教师所属院系：");
+        addTeacher(id, name, dept);
     }
+};
 
-    void enrollStudent() {
-        std::string sid = InputUtil::readString("输入学生ID：");
-        std::string cid = InputUtil::readString("输入课程ID：");
+class ScoreController {
+private:
+    ScoreRepository scoreRepo;
+public:
+    bool inputScore(const std::string& sid, const std::string& cid, double score) {
+        OperationTimer timer;
         try {
-            // 先校验学生和课程是否存在
-            studentRepo.getStudentById(sid);
-            courseRepo.getCourseById(cid);
-            enrollRepo.enroll(sid, cid);
+            ScoreResult result = scoreRepo.setScore(Score(sid, cid, score));
+            (result == ScoreResult::Ok ? std::cout : std::cerr) << describe(result, sid, cid) << '\n';
+            if (result != ScoreResult::Ok) timer.fail();
+            return result == ScoreResult::Ok;
         } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
+            std::cerr << e.what() << '\n';
+            timer.fail();
+            return false;
         }
     }
 
-    void dropStudentCourse() {
+    void inputScore() {
         std::string sid = InputUtil::readString("输入学生ID：");
         std::string cid = InputUtil::readString("输入课程ID：");
-        try {
-            enrollRepo.dropCourse(sid, cid);
-        } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
-        }
+        double score = InputUtil::readScore();
+        inputScore(sid, cid, score);
     }
 
-    void listStudentCourses() {
-        std::string sid = InputUtil::readString("输入学生ID：");
+    bool queryStudentScore(const std::string& sid) {
+        OperationTimer timer;
         try {
-            studentRepo.getStudentById(sid);
-            auto courses = enrollRepo.getEnrolledCourses(sid, courseRepo);
-            std::cout << "\n=== 学生【" << sid << "】已选课程 ===" << std::endl;
-            std::cout << std::left << std::setw(TABLE_WIDTH) << "课程ID"
-                      << std::setw(TABLE_WIDTH) << "课程名称"
-                      << std::setw(TABLE_WIDTH) << "学分" << std::endl;
-            std::cout << "---------------------------------------------" << std::endl;
-            for (const auto& c : courses) {
-                std::cout << std::left << std::setw(TABLE_WIDTH) << c.getId()
-                          << std::setw(TABLE_WIDTH) << c.getName()
-                          << std::setw(TABLE_WIDTH) << c.getCredit() << std::endl;
+            auto transcript = scoreRepo.getTranscript(sid);
+            TableRenderer table({"课程ID", "课程名称", "学分", "成绩"});
+            table.line("\n=== 学生【" + transcript.getStudent().getName() + "(" + sid + ")】成绩列表 ===");
+            table.header();
+            for (const auto& e : transcript.getEntries()) {
+                table.row(e.getCourseId(), e.getCourseName(), e.getCredit(), e.getScore());
             }
+            table.separator();
+            table.line(std::format("平均分：{:.1f}    学分加权平均分：{:.1f}",
+                                   transcript.getAverage(), transcript.getWeightedAverage()));
+            return true;
         } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
+            std::cerr << e.what() << '\n';
+            timer.fail();
+            return false;
         }
     }
-};
 
-class TeacherController {
-private:
-    TeacherRepository teacherRepo;
-public:
-    void addTeacher() {
-        std::string id = InputUtil::readString("输入教师ID：");
-        std::string name = InputUtil::readString("输入教师姓名：");
-        std::string dept = InputUtil::readString("输入教师所属院系：");
-        try {
-            teacherRepo.addTeacher(Teacher(id, name, dept));
-        } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
-        }
+    void queryStudentScore() {
+        queryStudentScore(InputUtil::readString("输入学生ID："));
     }
 };
 
-class ScoreController {
+// 批量导入控制器：按数据类型选择导入方式并汇报结果
+class ImportController {
 private:
-    ScoreRepository scoreRepo;
-    StudentRepository studentRepo;
-    CourseRepository courseRepo;
+    BulkImportRepository importRepo;
 public:
-    void inputScore() {
-        std::string sid = InputUtil::readString("输入学生ID：");
-        std::string cid = InputUtil::readString("输入课程ID：");
-        double score = InputUtil::readScore();
+    // kind：students / teachers / courses
+    bool importFile(const std::string& kind, const std::string& path) {
+        OperationTimer timer;
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "无法打开文件：" << path << '\n';
+            timer.fail();
+            return false;
+        }
         try {
-            studentRepo.getStudentById(sid);
-            courseRepo.getCourseById(cid);
-            scoreRepo.setScore(Score(sid, cid, score));
+            auto start = std::chrono::steady_clock::now();
+            ImportResult result;
+            if (kind == "students") result = importRepo.importStudents(file);
+            else if (kind == "teachers") result = importRepo.importTeachers(file);
+            else if (kind == "courses") result = importRepo.importCourses(file);
+            else {
+                std::cerr << "未知的导入类型：" << kind << "（应为students/teachers/courses）\n";
+                timer.fail();
+                return false;
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "导入【" << kind << "】完成：共 " << result.total << " 行，新增 " << result.inserted
+                      << " 行，跳过 " << result.skipped << " 行，耗时 " << std::fixed << std::setprecision(2)
+                      << seconds << "s\n";
+            return true;
         } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
+            std::cerr << e.what() << '\n';
+            timer.fail();
+            return false;
         }
     }
 
-    void queryStudentScore() {
-        std::string sid = InputUtil::readString("输入学生ID：");
+    // 上传课程成绩册并列出被拒绝的行
+    bool uploadGradebook(const std::string& courseId, const std::string& path) {
+        OperationTimer timer;
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "无法打开文件：" << path << '\n';
+            timer.fail();
+            return false;
+        }
         try {
-            auto student = studentRepo.getStudentById(sid);
-            auto scores = scoreRepo.getScoresByStudentId(sid);
-            std::cout << "\n=== 学生【" << student.getName() << "(" << sid << ")】成绩列表 ===" << std::endl;
-            std::cout << std::left << std::setw(TABLE_WIDTH) << "课程ID"
-                      << std::setw(TABLE_WIDTH) << "课程名称"
-                      << std::setw(TABLE_WIDTH) << "成绩" << std::endl;
-            std::cout << "---------------------------------------------" << std::endl;
-            double sum = 0.0;
-            for (const auto& s : scores) {
-                auto course = courseRepo.getCourseById(s.getCourseId());
-                sum += s.getScore();
-                std::cout << std::left << std::setw(TABLE_WIDTH) << s.getCourseId()
-                          << std::setw(TABLE_WIDTH) << course.getName()
-                          << std::setw(TABLE_WIDTH) << std::fixed << std::setprecision(1) << s.getScore() << std::endl;
-            }
-            std::cout << "---------------------------------------------" << std::endl;
-            std::cout << "平均分：" << std::fixed << std::setprecision(1) << sum / scores.size() << std::endl;
+            auto start = std::chrono::steady_clock::now();
+            GradebookResult result = importRepo.uploadGradebook(courseId, file);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "课程【" << courseId << "】成绩册上传完成：共 " << result.total << " 行，录入/更新 "
+                      << result.upserted << " 条，拒绝 " << result.rejected.size() << " 行，耗时 "
+                      << std::fixed << std::setprecision(2) << seconds << "s\n";
+            if (!result.rejected.empty()) {
+                TableRenderer table({"行号", "学生ID", "原因"});
+                table.header();
+                for (const auto& r : result.rejected) {
+                    table.row(r.line, r.studentId, r.reason);
+                }
+            }
+            return true;
         } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
+            std::cerr << e.what() << '\n';
+            timer.fail();
+            return false;
         }
     }
 };
@@ -661,16 +366,16 @@ private:
 
     // 打印主菜单
     void printMainMenu() {
-        std::cout << "\n=====================================" << std::endl;
-        std::cout << "=========== 学生选课管理系统 ===========" << std::endl;
-        std::cout << "=====================================" << std::endl;
-        std::cout << "1. 学生管理（增/删/查）" << std::endl;
-        std::cout << "2. 教师管理（新增）" << std::endl;
-        std::cout << "3. 课程管理（增/删/查）" << std::endl;
-        std::cout << "4. 选课/退课管理" << std::endl;
-        std::cout << "5. 成绩管理（录入/查询）" << std::endl;
-        std::cout << "0. 退出系统" << std::endl;
-        std::cout << "=====================================" << std::endl;
+        std::cout << "\n=====================================" << '\n';
+        std::cout << "=========== 学生选课管理系统 ===========" << '\n';
+        std::cout << "=====================================" << '\n';
+        std::cout << "1. 学生管理（增/删/查）" << '\n';
+        std::cout << "2. 教师管理（新增）" << '\n';
+        std::cout << "3. 课程管理（增/删/查）" << '\n';
+        std::cout << "4. 选课/退课管理" << '\n';
+        std::cout << "5. 成绩管理（录入/查询）" << '\n';
+        std::cout << "0. 退出系统" << '\n';
+        std::cout << "=====================================" << '\n';
         std::cout << "请输入功能编号：";
     }
 
@@ -678,18 +383,18 @@ private:
     void studentMenu() {
         int choice;
         do {
-            std::cout << "\n----- 学生管理子菜单 -----" << std::endl;
-            std::cout << "1. 新增学生" << std::endl;
-            std::cout << "2. 删除学生" << std::endl;
-            std::cout << "3. 查看所有学生" << std::endl;
-            std::cout << "0. 返回主菜单" << std::endl;
+            std::cout << "\n----- 学生管理子菜单 -----" << '\n';
+            std::cout << "1. 新增学生" << '\n';
+            std::cout << "2. 删除学生" << '\n';
+            std::cout << "3. 查看所有学生" << '\n';
+            std::cout << "0. 返回主菜单" << '\n';
             std::cout << "请输入选择：";
             choice = InputUtil::readInt(0, 3);
             switch (choice) {
                 case 1: studentCtrl.addStudent(); break;
                 case 2: studentCtrl.deleteStudent(); break;
                 case 3: studentCtrl.listAllStudents(); break;
-                case 0: std::cout << "返回主菜单..." << std::endl; break;
+                case 0: std::cout << "返回主菜单..." << '\n'; break;
             }
         } while (choice != 0);
     }
@@ -698,14 +403,14 @@ private:
     void teacherMenu() {
         int choice;
         do {
-            std::cout << "\n----- 教师管理子菜单 -----" << std::endl;
-            std::cout << "1. 新增教师" << std::endl;
-            std::cout << "0. 返回主菜单" << std::endl;
+            std::cout << "\n----- 教师管理子菜单 -----" << '\n';
+            std::cout << "1. 新增教师" << '\n';
+            std::cout << "0. 返回主菜单" << '\n';
             std::cout << "请输入选择：";
             choice = InputUtil::readInt(0, 1);
             switch (choice) {
                 case 1: teacherCtrl.addTeacher(); break;
-                case 0: std::cout << "返回主菜单..." << std::endl; break;
+                case 0: std::cout << "返回主菜单..." << '\n'; break;
             }
         } while (choice != 0);
     }
@@ -714,18 +419,18 @@ private:
     void courseMenu() {
         int choice;
         do {
-            std::cout << "\n----- 课程管理子菜单 -----" << std::endl;
-            std::cout << "1. 新增课程" << std::endl;
-            std::cout << "2. 删除课程" << std::endl;
-            std::cout << "3. 查看所有课程" << std::endl;
-            std::cout << "0. 返回主菜单" << std::endl;
+            std::cout << "\n----- 课程管理子菜单 -----" << '\n';
+            std::cout << "1. 新增课程" << '\n';
+            std::cout << "2. 删除课程" << '\n';
+            std::cout << "3. 查看所有课程" << '\n';
+            std::cout << "0. 返回主菜单" << '\n';
             std::cout << "请输入选择：";
             choice = InputUtil::readInt(0, 3);
             switch (choice) {
                 case 1: courseCtrl.addCourse(); break;
                 case 2: courseCtrl.deleteCourse(); break;
                 case 3: courseCtrl.listAllCourses(); break;
-                case 0: std::cout << "返回主菜单..." << std::endl; break;
+                case 0: std::cout << "返回主菜单..." << '\n'; break;
             }
         } while (choice != 0);
     }
@@ -734,18 +439,18 @@ private:
     void enrollMenu() {
         int choice;
         do {
-            std::cout << "\n----- 选课/退课管理子菜单 -----" << std::endl;
-            std::cout << "1. 学生选课" << std::endl;
-            std::cout << "2. 学生退课" << std::endl;
-            std::cout << "3. 查看学生已选课程" << std::endl;
-            std::cout << "0. 返回主菜单" << std::endl;
+            std::cout << "\n----- 选课/退课管理子菜单 -----" << '\n';
+            std::cout << "1. 学生选课" << '\n';
+            std::cout << "2. 学生退课" << '\n';
+            std::cout << "3. 查看学生已选课程" << '\n';
+            std::cout << "0. 返回主菜单" << '\n';
             std::cout << "请输入选择：";
             choice = InputUtil::readInt(0, 3);
             switch (choice) {
                 case 1: courseCtrl.enrollStudent(); break;
                 case 2: courseCtrl.dropStudentCourse(); break;
                 case 3: courseCtrl.listStudentCourses(); break;
-                case 0: std::cout << "返回主菜单..." << std::endl; break;
+                case 0: std::cout << "返回主菜单..." << '\n'; break;
             }
         } while (choice != 0);
     }
@@ -754,24 +459,43 @@ private:
     void scoreMenu() {
         int choice;
         do {
-            std::cout << "\n----- 成绩管理子菜单 -----" << std::endl;
-            std::cout << "1. 录入/更新成绩" << std::endl;
-            std::cout << "2. 查询学生成绩（含平均分）" << std::endl;
-            std::cout << "0. 返回主菜单" << std::endl;
+            std::cout << "\n----- 成绩管理子菜单 -----" << '\n';
+            std::cout << "1. 录入/更新成绩" << '\n';
+            std::cout << "2. 查询学生成绩（含平均分）" << '\n';
+            std::cout << "0. 返回主菜单" << '\n';
             std::cout << "请输入选择：";
             choice = InputUtil::readInt(0, 2);
             switch (choice) {
                 case 1: scoreCtrl.inputScore(); break;
                 case 2: scoreCtrl.queryStudentScore(); break;
-                case 0: std::cout << "返回主菜单..." << std::endl; break;
+                case 0: std::cout << "返回主菜单..." << '\n'; break;
             }
         } while (choice != 0);
     }
 
+    // 打印连接池统计信息
+    void printPoolStats() {
+        auto st = DBUtil::pool().stats();
+        std::cout << "连接池统计：上限 " << st.capacity << "，已创建 " << st.created
+                  << "，使用中 " << st.inUse << "，空闲 " << st.idle
+                  << "，借用 " << st.acquires << " 次，等待 " << st.waits << " 次"
+                  << "，累计等待 " << std::fixed << std::setprecision(2) << st.totalWaitMs << "ms"
+                  << "，最长等待 " << st.maxWaitMs << "ms\n";
+    }
+
 public:
     void run() {
         try {
-            std::cout << "系统启动中...数据库连接成功！" << std::endl;
+            // 数据库后端预先建立一条连接，尽早发现配置错误；其余连接按需创建
+            const bool database = Storage::current().usesDatabase();
+            if (database) {
+                DBUtil::pool().acquire();
+                std::cout << "系统启动中...数据库连接成功！\n";
+            } else if (Storage::current().name() == "memory") {
+                std::cout << "系统启动中...使用内存存储（演示模式，退出后数据不保留）\n";
+            } else {
+                std::cout << "系统启动中...本地数据文件加载完成！\n";
+            }
             int choice;
             do {
                 printMainMenu();
@@ -782,18 +506,1091 @@ public:
                     case 3: courseMenu(); break;
                     case 4: enrollMenu(); break;
                     case 5: scoreMenu(); break;
-                    case 0: std::cout << "\n感谢使用学生选课管理系统，再见！" << std::endl; break;
+                    case 0: std::cout << "\n感谢使用学生选课管理系统，再见！\n"; break;
                 }
             } while (choice != 0);
+            if (database) printPoolStats();
         } catch (const std::exception& e) {
-            std::cerr << "\n系统启动失败：" << e.what() << std::endl;
-            std::cerr << "请检查数据库连接或表结构是否正确！" << std::endl;
+            std::cerr << "\n系统启动失败：" << e.what() << '\n';
+            std::cerr << "请检查数据库连接或表结构是否正确！\n";
         }
     }
 };
 
+// 批量命令模式：逐行读取命令文件或标准输入，不显示菜单，直接调用控制器执行；
+// 输出全部缓冲，可选每N条命令合并为一个事务、由多个工作线程并发执行，结束时汇报吞吐量
+class BatchRunner {
+private:
+    struct Command {
+        std::size_t argc;                                       // 参数个数（不含命令名）
+        std::string usage;
+        std::function<bool(const std::vector<std::string>&)> run;
+    };
+
+    StudentController studentCtrl;
+    CourseController courseCtrl;
+    TeacherController teacherCtrl;
+    ScoreController scoreCtrl;
+    std::unordered_map<std::string, Command> commands;
+
+    // 待执行的一条命令（参数已校验）
+    struct Invocation {
+        const Command* command;
+        std::vector<std::string> args;
+        std::size_t lineNo;    // 所在行号，回滚时用于指明哪些命令的输出作废
+        std::string line;
+    };
+
+    struct Tally {
+        std::size_t succeeded = 0;
+        std::size_t failed = 0;
+    };
+
+    // 并发执行时的分组输出：控制器直接写std::cout/std::cerr，因此替换两者的streambuf。
+    // 工作线程在Capture存续期间的输出写入本线程的缓冲区，Capture析构时整组一次写出，不同组的输出不交错；
+    // 其他线程（及未开启捕获时）照常转发到原streambuf
+    class GroupOutput {
+    private:
+        struct Buffers {
+            bool active = false;
+            std::array<std::string, 2> text;   // 0为std::cout，1为std::cerr
+        };
+
+        static Buffers& buffers() {
+            thread_local Buffers current;
+            return current;
+        }
+
+        static std::mutex& writeMtx() {
+            static std::mutex mtx;
+            return mtx;
+        }
+
+        class Redirect : public std::streambuf {
+        private:
+            std::ostream& stream;
+            std::size_t slot;
+        public:
+            std::streambuf* const original;
+
+            Redirect(std::ostream& stream, std::size_t slot) : stream(stream), slot(slot), original(stream.rdbuf(this)) {}
+            Redirect(const Redirect&) = delete;
+            Redirect& operator=(const Redirect&) = delete;
+            ~Redirect() override { stream.rdbuf(original); }
+
+        protected:
+            std::streamsize xsputn(const char* s, std::streamsize n) override {
+                if (buffers().active) {
+                    buffers().text[slot].append(s, static_cast<std::size_t>(n));
+                    return n;
+                }
+                std::lock_guard lock(writeMtx());
+                return original->sputn(s, n);
+            }
+
+            int_type overflow(int_type ch) override {
+                if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+                char c = traits_type::to_char_type(ch);
+                return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+            }
+
+            int sync() override { return buffers().active ? 0 : original->pubsync(); }
+        };
+
+        Redirect out{std::cout, 0}, err{std::cerr, 1};
+
+    public:
+        class Capture {
+        private:
+            const GroupOutput& output;
+        public:
+            explicit Capture(const GroupOutput& output) : output(output) { buffers().active = true; }
+            Capture(const Capture&) = delete;
+            Capture& operator=(const Capture&) = delete;
+            ~Capture() {
+                Buffers& b = buffers();
+                b.active = false;
+                std::lock_guard lock(writeMtx());
+                output.out.original->sputn(b.text[0].data(), static_cast<std::streamsize>(b.text[0].size()));
+                output.err.original->sputn(b.text[1].data(), static_cast<std::streamsize>(b.text[1].size()));
+                output.out.original->pubsync();
+                output.err.original->pubsync();
+                b.text[0].clear();
+                b.text[1].clear();
+            }
+        };
+    };
+
+    // 执行一组命令：transactional时整组共用一个批量事务，提交失败则整组计为失败。
+    // 命令的成功输出在执行时即已打印，提交失败时逐条列出被回滚的命令，使这些输出作废
+    static Tally runGroup(const std::vector<Invocation>& group, bool transactional) {
+        Tally tally;
+        std::optional<TransactionScope> scope;
+        if (transactional) {
+            try {
+                scope.emplace();
+            } catch (const std::exception& e) {
+                std::cerr << "开启批量事务失败：" << e.what() << '\n';
+                tally.failed = group.size();
+                return tally;
+            }
+        }
+        for (const auto& inv : group) {
+            if (inv.command->run(inv.args)) {
+                ++tally.succeeded;
+            } else {
+                ++tally.failed;
+            }
+        }
+        if (scope) {
+            try {
+                scope->commit();
+            } catch (const std::exception& e) {
+                std::cerr << "批量事务提交失败，本组" << group.size() << "条命令全部回滚，其执行时的成功输出作废：" << e.what() << '\n';
+                for (const auto& inv : group) {
+                    std::cerr << "  第" << inv.lineNo << "行已回滚：" << inv.line << '\n';
+                }
+                tally.failed += std::exchange(tally.succeeded, 0);
+            }
+        }
+        return tally;
+    }
+
+    static std::optional<double> parseNumber(const std::string& text, double min, double max) {
+        double value = 0.0;
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (ec != std::errc() || ptr != text.data() + text.size() || value < min || value > max) return std::nullopt;
+        return value;
+    }
+
+public:
+    BatchRunner() {
+        commands = {
+            {"add-student", {3, "add-student <学生ID> <姓名> <专业>", [this](const auto& a) {
+                return studentCtrl.addStudent(a[0], a[1], a[2]); }}},
+            {"delete-student", {1, "delete-student <学生ID>", [this](const auto& a) {
+                return studentCtrl.deleteStudent(a[0]); }}},
+            {"list-students", {0, "list-students", [this](const auto&) {
+                return studentCtrl.listAllStudents(); }}},
+            {"add-teacher", {3, "add-teacher <教师ID> <姓名> <院系>", [this](const auto& a) {
+                return teacherCtrl.addTeacher(a[0], a[1], a[2]); }}},
+            {"add-course", {4, "add-course <课程ID> <课程名称> <学分1-10> <教师ID>", [this](const auto& a) {
+                auto credit = parseNumber(a[2], 1, 10);
+                if (!credit || *credit != static_cast<int>(*credit)) {
+                    std::cerr << "学分【" << a[2] << "】无效，应为1-10的整数\n";
+                    return false;
+                }
+                return courseCtrl.addCourse(a[0], a[1], static_cast<int>(*credit), a[3]); }}},
+            {"delete-course", {1, "delete-course <课程ID>", [this](const auto& a) {
+                return courseCtrl.deleteCourse(a[0]); }}},
+            {"delete-course-chunked", {2, "delete-course-chunked <课程ID> <每批学生数>", [this](const auto& a) {
+                std::size_t chunkSize = 0;
+                auto [ptr, ec] = std::from_chars(a[1].data(), a[1].data() + a[1].size(), chunkSize);
+                if (ec != std::errc() || ptr != a[1].data() + a[1].size() || chunkSize == 0) {
+                    std::cerr << "每批学生数【" << a[1] << "】无效，应为正整数\n";
+                    return false;
+                }
+                return courseCtrl.deleteCourse(a[0], chunkSize); }}},
+            {"list-courses", {0, "list-courses", [this](const auto&) {
+                return courseCtrl.listAllCourses(); }}},
+            {"set-capacity", {2, "set-capacity <课程ID> <容量|none>", [this](const auto& a) {
+                if (a[1] == "none") return courseCtrl.setCapacity(a[0], std::nullopt);
+                auto capacity = parseNumber(a[1], 0, std::numeric_limits<int>::max());
+                if (!capacity || *capacity != static_cast<int>(*capacity)) {
+                    std::cerr << "容量【" << a[1] << "】无效，应为非负整数或none\n";
+                    return false;
+                }
+                return courseCtrl.setCapacity(a[0], static_cast<int>(*capacity)); }}},
+            {"enroll", {2, "enroll <学生ID> <课程ID>", [this](const auto& a) {
+                return courseCtrl.enrollStudent(a[0], a[1]); }}},
+            {"drop", {2, "drop <学生ID> <课程ID>", [this](const auto& a) {
+                return courseCtrl.dropStudentCourse(a[0], a[1]); }}},
+            {"courses", {1, "courses <学生ID>", [this](const auto& a) {
+                return courseCtrl.listStudentCourses(a[0]); }}},
+            {"score", {3, "score <学生ID> <课程ID> <成绩0-100>", [this](const auto& a) {
+                auto score = parseNumber(a[2], 0, 100);
+                if (!score) {
+                    std::cerr << "成绩【" << a[2] << "】无效，应为0-100的数字\n";
+                    return false;
+                }
+                return scoreCtrl.inputScore(a[0], a[1], *score); }}},
+            {"transcript", {1, "transcript <学生ID>", [this](const auto& a) {
+                return scoreCtrl.queryStudentScore(a[0]); }}},
+        };
+    }
+
+    // groupSize为0或1时每条命令独立提交；否则每groupSize条命令共用一个事务（命令各自以保存点隔离，
+    // 存储后端不使用数据库时没有事务，分组只影响任务划分）。
+    // workers大于0时每组（或每条）命令作为一个任务提交到RequestExecutor并发执行，完成顺序与输入顺序无关，
+    // 每组的输出在该组结束后整组写出（见GroupOutput）
+    bool run(std::istream& in, std::size_t groupSize, std::size_t workers = 0) {
+        std::size_t total = 0, succeeded = 0, failed = 0;
+        const bool transactional = groupSize > 1 && Storage::current().usesDatabase();
+        const std::size_t perGroup = std::max<std::size_t>(1, groupSize);
+        std::optional<GroupOutput> output;
+        std::optional<RequestExecutor> executor;
+        if (workers > 0) {
+            output.emplace();
+            executor.emplace(workers);
+        }
+        std::vector<std::future<Tally>> pending;
+        std::vector<Invocation> group;
+        auto flushGroup = [&] {
+            if (group.empty()) return;
+            if (executor) {
+                pending.push_back(executor->submit([group = std::move(group), transactional, &output] {
+                    GroupOutput::Capture capture(*output);
+                    return runGroup(group, transactional);
+                }));
+            } else {
+                Tally tally = runGroup(group, transactional);
+                succeeded += tally.succeeded;
+                failed += tally.failed;
+            }
+            group.clear();
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        std::uint64_t tripsBefore = DBUtil::roundTrips();
+        std::string line;
+        std::size_t lineNo = 0;
+        while (std::getline(in, line)) {
+            ++lineNo;
+            std::istringstream tokens(line);
+            std::vector<std::string> args;
+            for (std::string tok; tokens >> tok;) args.push_back(std::move(tok));
+            if (args.empty() || args[0].starts_with('#')) continue;
+
+            ++total;
+            auto it = commands.find(args[0]);
+            if (it == commands.end() || args.size() - 1 != it->second.argc) {
+                std::cerr << "第" << lineNo << "行：" << (it == commands.end() ? "未知命令【" + args[0] + "】"
+                                                                          : "用法：" + it->second.usage) << '\n';
+                ++failed;
+                continue;
+            }
+            args.erase(args.begin());
+            group.push_back(Invocation{&it->second, std::move(args), lineNo, line});
+            if (group.size() >= perGroup) flushGroup();
+        }
+        flushGroup();
+        for (auto& f : pending) {
+            Tally tally = f.get();
+            succeeded += tally.succeeded;
+            failed += tally.failed;
+        }
+        std::uint64_t trips = DBUtil::roundTrips() - tripsBefore;
+        if (executor) trips += executor->stats().roundTrips;
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "\n批量执行完成：共 " << total << " 条命令，成功 " << succeeded << " 条，失败 " << failed
+                  << " 条，耗时 " << std::fixed << std::setprecision(3) << seconds << "s，吞吐 "
+                  << std::setprecision(1) << (seconds > 0 ? total / seconds : 0.0) << " 条/秒，数据库往返 "
+                  << trips << " 次";
+        if (executor) {
+            auto stats = executor->stats();
+            std::cout << "，工作线程 " << stats.workers << " 个，窃取任务 " << stats.stolen << " 个";
+        }
+        std::cout << '\n';
+        return failed == 0;
+    }
+};
+
+// 服务模式：基于epoll的HTTP/1.1服务，仅监听本机。请求参数取自查询字符串或
+// application/x-www-form-urlencoded请求体，响应为JSON。事件循环在主线程中解析请求、收发数据，
+// 请求交给RequestExecutor的工作线程执行；同一连接上的流水线请求按到达顺序返回响应
+class HttpServer {
+private:
+    struct Request {
+        std::string method;
+        std::vector<std::string> path;                          // 已解码的路径段
+        std::unordered_map<std::string, std::string> params;   // 查询参数与表单参数
+    };
+
+    struct Response {
+        int status;
+        std::string body;
+    };
+
+    struct Connection {
+        int fd = -1;
+        std::string in;                                 // 尚未解析的输入
+        std::string out;                                // 尚未发送的输出
+        std::deque<std::future<std::string>> pending;   // 按请求顺序排队的响应
+        bool closeAfter = false;                        // 已排队的响应发送完后关闭
+        bool readClosed = false;                        // 对端已关闭写方向，不再关注可读事件
+        std::uint32_t events = EPOLLIN | EPOLLRDHUP;    // 当前注册的epoll事件
+    };
+
+    // epoll事件的data.u64：固定句柄之后为连接编号
+    static constexpr std::uint64_t LISTENER = 0, WAKEUP = 1, SIGNALS = 2;
+
+    StudentRepository studentRepo;
+    TeacherRepository teacherRepo;
+    CourseRepository courseRepo;
+    EnrollmentRepository enrollRepo;
+    ScoreRepository scoreRepo;
+
+    std::uint16_t port;
+    std::size_t workers;
+    std::size_t maxInflight;
+    int epfd = -1, listenfd = -1, wakefd = -1, sigfd = -1;
+    int sparefd = -1;              // 预留的描述符，描述符耗尽时用来接受并关闭一个连接（见accept）
+    bool listenerPaused = false;   // 预留描述符也无法取得时暂停监听，直到有连接关闭
+    std::unordered_map<std::uint64_t, Connection> conns;
+    std::uint64_t nextConnId = SIGNALS + 1;
+    std::size_t inflight = 0;
+    std::uint64_t served = 0, rejected = 0;
+
+    // 工作线程完成请求后登记连接编号并唤醒事件循环
+    std::mutex doneMtx;
+    std::vector<std::uint64_t> done;
+
+    // ---------- JSON ----------
+    static void appendJson(std::string& out, std::string_view text) {
+        out += '"';
+        for (char ch : text) {
+            switch (ch) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(ch) < 0x20) out += std::format("\\u{:04x}", static_cast<int>(ch));
+                    else out += ch;
+            }
+        }
+        out += '"';
+    }
+
+    static std::string json(const Student& s) {
+        std::string out = "{\"id\":";
+        appendJson(out, s.getId());
+        out += ",\"name\":";
+        appendJson(out, s.getName());
+        out += ",\"major\":";
+        appendJson(out, s.getMajor());
+        return out + "}";
+    }
+
+    static std::string json(const Teacher& t) {
+        std::string out = "{\"id\":";
+        appendJson(out, t.getId());
+        out += ",\"name\":";
+        appendJson(out, t.getName());
+        out += ",\"department\":";
+        appendJson(out, t.getDepartment());
+        return out + "}";
+    }
+
+    static std::string json(const Course& c) {
+        std::string out = "{\"id\":";
+        appendJson(out, c.getId());
+        out += ",\"name\":";
+        appendJson(out, c.getName());
+        out += std::format(",\"credit\":{},\"teacherId\":", c.getCredit());
+        appendJson(out, c.getTeacherId());
+        return out + "}";
+    }
+
+    static std::string json(const Transcript& t) {
+        std::string out = "{\"student\":" + json(t.getStudent()) + ",\"entries\":[";
+        for (std::size_t i = 0; i < t.getEntries().size(); ++i) {
+            const auto& e = t.getEntries()[i];
+            if (i) out += ',';
+            out += "{\"courseId\":";
+            appendJson(out, e.getCourseId());
+            out += ",\"courseName\":";
+            appendJson(out, e.getCourseName());
+            out += std::format(",\"credit\":{},\"score\":{:.1f}}}", e.getCredit(), e.getScore());
+        }
+        return out + std::format("],\"average\":{:.1f},\"weightedAverage\":{:.1f}}}",
+                                 t.getAverage(), t.getWeightedAverage());
+    }
+
+    template<typename T>
+    static std::string json(const std::vector<T>& items) {
+        std::string out = "[";
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            if (i) out += ',';
+            out += json(items[i]);
+        }
+        return out + "]";
+    }
+
+    static Response message(int status, std::string_view text) {
+        std::string body = status < 400 ? "{\"message\":" : "{\"error\":";
+        appendJson(body, text);
+        return Response{status, body + "}"};
+    }
+
+    static Response notFound(std::string_view kind, const std::string& id) {
+        return message(404, std::string(kind) + "ID【" + id + "】不存在");
+    }
+
+    // ---------- 请求解析 ----------
+    static std::string percentDecode(std::string_view text) {
+        std::string out;
+        out.reserve(text.size());
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            if (text[i] == '+') {
+                out += ' ';
+            } else if (text[i] == '%' && i + 2 < text.size()) {
+                int value = 0;
+                auto [ptr, ec] = std::from_chars(text.data() + i + 1, text.data() + i + 3, value, 16);
+                if (ec == std::errc() && ptr == text.data() + i + 3) {
+                    out += static_cast<char>(value);
+                    i += 2;
+                } else {
+                    out += '%';
+                }
+            } else {
+                out += text[i];
+            }
+        }
+        return out;
+    }
+
+    static void parseParams(std::string_view text, std::unordered_map<std::string, std::string>& params) {
+        for (auto part : std::views::split(text, '&')) {
+            std::string_view kv(part.begin(), part.end());
+            if (kv.empty()) continue;
+            auto eq = kv.find('=');
+            params[percentDecode(kv.substr(0, eq))] = eq == std::string_view::npos ? "" : percentDecode(kv.substr(eq + 1));
+        }
+    }
+
+    static std::optional<std::string_view> header(std::string_view head, std::string_view name) {
+        for (auto part : std::views::split(head, std::string_view("\r\n"))) {
+            std::string_view line(part.begin(), part.end());
+            auto colon = line.find(':');
+            if (colon != name.size()) continue;
+            bool match = std::ranges::equal(line.substr(0, colon), name, [](char a, char b) {
+                return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+            });
+            if (!match) continue;
+            std::string_view value = line.substr(colon + 1);
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+            return value;
+        }
+        return std::nullopt;
+    }
+
+    static bool iequals(std::string_view a, std::string_view b) {
+        return std::ranges::equal(a, b, [](char x, char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    }
+
+    static std::string serialize(const Response& r, bool keepAlive) {
+        static const std::unordered_map<int, std::string_view> reasons = {
+            {200, "OK"}, {201, "Created"}, {400, "Bad Request"}, {404, "Not Found"}, {405, "Method Not Allowed"},
+            {409, "Conflict"}, {411, "Length Required"}, {413, "Payload Too Large"}, {500, "Internal Server Error"},
+            {501, "Not Implemented"}, {503, "Service Unavailable"},
+        };
+        auto it = reasons.find(r.status);
+        return std::format("HTTP/1.1 {} {}\r\nContent-Type: application/json; charset=utf-8\r\n"
+                           "Content-Length: {}\r\n{}\r\n{}",
+                           r.status, it == reasons.end() ? "Unknown" : it->second, r.body.size(),
+                           keepAlive ? "" : "Connection: close\r\n", r.body);
+    }
+
+    // ---------- 路由 ----------
+    static const std::string* param(const Request& req, const std::string& name) {
+        auto it = req.params.find(name);
+        return it == req.params.end() || it->second.empty() ? nullptr : &it->second;
+    }
+
+    static Response missing(std::string_view names) {
+        return message(400, "缺少参数：" + std::string(names));
+    }
+
+    // 在工作线程中执行；各接口与对应控制器操作的校验一致。
+    // 所有接口都经仓库执行：查询/删除/退课等使用不抛业务异常的版本，按返回值（空值、false、结果码）映射为404/409，
+    // 异常只来自存储错误，对应500
+    Response handle(const Request& req) {
+        const auto& p = req.path;
+        const std::string& m = req.method;
+        OperationTimer timer;
+        try {
+            if (p.size() == 1 && p[0] == "students") {
+                if (m == "GET") return Response{200, json(studentRepo.getAllStudents())};
+                if (m != "POST") return message(405, "不支持的方法");
+                auto id = param(req, "id"), name = param(req, "name"), major = param(req, "major");
+                if (!id || !name || !major) return missing("id, name, major");
+                studentRepo.addStudent(Student(*id, *name, *major));
+                return message(201, "学生新增成功");
+            }
+            if (p.size() == 2 && p[0] == "students") {
+                if (m == "GET") {
+                    auto student = studentRepo.findStudent(p[1]);
+                    return student ? Response{200, json(*student)} : notFound("学生", p[1]);
+                }
+                if (m != "DELETE") return message(405, "不支持的方法");
+                auto r = studentRepo.tryDeleteStudent(p[1]);
+                if (!r) return notFound("学生", p[1]);
+                return Response{200, std::format("{{\"scores\":{},\"enrollments\":{}}}", r->scores, r->enrollments)};
+            }
+            if (p.size() == 3 && p[0] == "students" && p[2] == "courses") {
+                if (m != "GET") return message(405, "不支持的方法");
+                auto courses = enrollRepo.findEnrolledCourses(p[1]);
+                return courses ? Response{200, json(*courses)} : notFound("学生", p[1]);
+            }
+            if (p.size() == 3 && p[0] == "students" && p[2] == "transcript") {
+                if (m != "GET") return message(405, "不支持的方法");
+                auto transcript = scoreRepo.findTranscript(p[1]);
+                return transcript ? Response{200, json(*transcript)} : notFound("学生", p[1]);
+            }
+            if (p.size() == 1 && p[0] == "teachers") {
+                if (m != "POST") return message(405, "不支持的方法");
+                auto id = param(req, "id"), name = param(req, "name"), dept = param(req, "department");
+                if (!id || !name || !dept) return missing("id, name, department");
+                teacherRepo.addTeacher(Teacher(*id, *name, *dept));
+                return message(201, "教师新增成功");
+            }
+            if (p.size() == 2 && p[0] == "teachers") {
+                if (m != "GET") return message(405, "不支持的方法");
+                auto teacher = teacherRepo.findTeacher(p[1]);
+                return teacher ? Response{200, json(*teacher)} : notFound("教师", p[1]);
+            }
+            if (p.size() == 1 && p[0] == "courses") {
+                if (m == "GET") return Response{200, json(courseRepo.getAllCourses())};
+                if (m != "POST") return message(405, "不支持的方法");
+                auto id = param(req, "id"), name = param(req, "name"), credit = param(req, "credit"),
+                     tid = param(req, "teacherId");
+                if (!id || !name || !credit || !tid) return missing("id, name, credit, teacherId");
+                int value = 0;
+                auto [ptr, ec] = std::from_chars(credit->data(), credit->data() + credit->size(), value);
+                if (ec != std::errc() || ptr != credit->data() + credit->size() || value < 1 || value > 10) {
+                    return message(400, "学分【" + *credit + "】无效，应为1-10的整数");
+                }
+                if (!teacherRepo.findTeacher(*tid)) return notFound("教师", *tid);
+                courseRepo.addCourse(Course(*id, *name, value, *tid));
+                return message(201, "课程新增成功");
+            }
+            if (p.size() == 2 && p[0] == "courses") {
+                if (m == "GET") {
+                    auto course = courseRepo.findCourse(p[1]);
+                    return course ? Response{200, json(*course)} : notFound("课程", p[1]);
+                }
+                if (m != "DELETE") return message(405, "不支持的方法");
+                std::size_t chunk = 0;
+                if (auto c = param(req, "chunk")) {
+                    auto [ptr, ec] = std::from_chars(c->data(), c->data() + c->size(), chunk);
+                    if (ec != std::errc() || ptr != c->data() + c->size()) return message(400, "chunk参数无效");
+                }
+                auto r = courseRepo.tryDeleteCourse(p[1], chunk);
+                if (!r) return notFound("课程", p[1]);
+                return Response{200, std::format("{{\"scores\":{},\"enrollments\":{},\"batches\":{}}}",
+                                                 r->scores, r->enrollments, r->batches)};
+            }
+            if (p.size() == 3 && p[0] == "courses" && p[2] == "capacity") {
+                if (m != "PUT") return message(405, "不支持的方法");
+                std::optional<int> capacity;
+                if (auto c = param(req, "capacity")) {
+                    int value = 0;
+                    auto [ptr, ec] = std::from_chars(c->data(), c->data() + c->size(), value);
+                    if (ec != std::errc() || ptr != c->data() + c->size() || value < 0) {
+                        return message(400, "容量【" + *c + "】无效，应为非负整数，不传表示不限");
+                    }
+                    capacity = value;
+                }
+                if (!courseRepo.trySetCapacity(p[1], capacity)) return notFound("课程", p[1]);
+                if (Storage::current().usesDatabase()) SeatAllocator::instance().reconcile();
+                return message(200, "课程容量已更新");
+            }
+            if (p.size() == 1 && p[0] == "enrollments") {
+                auto sid = param(req, "studentId"), cid = param(req, "courseId");
+                if (!sid || !cid) return missing("studentId, courseId");
+                if (m == "DELETE") {
+                    if (!enrollRepo.tryDropCourse(*sid, *cid)) return message(404, "未选该课程，无法退课");
+                    return message(200, "退课成功");
+                }
+                if (m != "POST") return message(405, "不支持的方法");
+                EnrollResult result = enrollRepo.enroll(*sid, *cid);
+                int status = result == EnrollResult::Ok ? 201
+                           : result == EnrollResult::AlreadyEnrolled || result == EnrollResult::CourseFull ? 409 : 404;
+                return message(status, describe(result, *sid, *cid));
+            }
+            if (p.size() == 1 && p[0] == "scores") {
+                if (m != "PUT" && m != "POST") return message(405, "不支持的方法");
+                auto sid = param(req, "studentId"), cid = param(req, "courseId"), score = param(req, "score");
+                if (!sid || !cid || !score) return missing("studentId, courseId, score");
+                double value = 0.0;
+                auto [ptr, ec] = std::from_chars(score->data(), score->data() + score->size(), value);
+                if (ec != std::errc() || ptr != score->data() + score->size() || value < 0 || value > 100) {
+                    return message(400, "成绩【" + *score + "】无效，应为0-100的数字");
+                }
+                ScoreResult result = scoreRepo.setScore(Score(*sid, *cid, value));
+                int status = result == ScoreResult::Ok ? 200 : result == ScoreResult::NotEnrolled ? 409 : 404;
+                return message(status, describe(result, *sid, *cid));
+            }
+            return message(404, "未知接口");
+        } catch (const std::exception& e) {
+            timer.fail();
+            return message(500, e.what());
+        }
+    }
+
+    // ---------- 事件循环 ----------
+    static void check(int rc, const char* what) {
+        if (rc < 0) throw std::runtime_error(std::string(what) + "失败：" + std::strerror(errno));
+    }
+
+    void watch(int fd, std::uint64_t key, std::uint32_t events, int op = EPOLL_CTL_ADD) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.u64 = key;
+        check(epoll_ctl(epfd, op, fd, &ev), "epoll_ctl");
+    }
+
+    // 监听套接字为水平触发：描述符耗尽（EMFILE/ENFILE）时待接受的连接一直留在队列中，epoll_wait立即返回而空转。
+    // 此时关闭预留的描述符腾出位置，接受该连接后立即关闭（客户端得到连接关闭而不是一直等待），再重新预留；
+    // 预留描述符也取不回时暂停监听，由close()在有连接关闭后恢复
+    void accept() {
+        while (true) {
+            int fd = ::accept4(listenfd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                switch (errno) {
+                    case EAGAIN:
+                        return;
+                    case EINTR:
+                    case ECONNABORTED:
+                    case EPROTO:
+                        continue;   // 连接在接受前已被对端放弃，接受下一个
+                    case EMFILE:
+                    case ENFILE:
+                        if (sparefd >= 0) {
+                            ::close(sparefd);
+                            if (int dropped = ::accept4(listenfd, nullptr, nullptr, SOCK_CLOEXEC); dropped >= 0) ::close(dropped);
+                            sparefd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+                            continue;
+                        }
+                        std::clog << "文件描述符已耗尽，暂停接受新连接\n";
+                        watch(listenfd, LISTENER, 0, EPOLL_CTL_MOD);
+                        listenerPaused = true;
+                        return;
+                    default:
+                        std::clog << "接受连接失败：" << std::strerror(errno) << '\n';
+                        return;
+                }
+            }
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            std::uint64_t id = nextConnId++;
+            conns[id].fd = fd;
+            watch(fd, id, EPOLLIN | EPOLLRDHUP);
+        }
+    }
+
+    void close(std::uint64_t id) {
+        auto it = conns.find(id);
+        if (it == conns.end()) return;
+        ::close(it->second.fd);   // 关闭即从epoll中移除；未完成的请求完成后按编号找不到连接，直接丢弃
+        conns.erase(it);
+        if (listenerPaused) {
+            if (sparefd < 0) sparefd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+            watch(listenfd, LISTENER, EPOLLIN, EPOLL_CTL_MOD);
+            listenerPaused = false;
+        }
+    }
+
+    // 将完成的请求提交给工作线程；在途请求达到上限时直接返回503
+    void dispatch(std::uint64_t id, Connection& conn, Request req, bool keepAlive) {
+        if (inflight >= maxInflight) {
+            ++rejected;
+            std::promise<std::string> ready;
+            ready.set_value(serialize(message(503, "服务繁忙，请稍后重试"), keepAlive));
+            conn.pending.push_back(ready.get_future());
+            return;
+        }
+        ++inflight;
+        auto promise = std::make_shared<std::promise<std::string>>();
+        conn.pending.push_back(promise->get_future());
+        executor->submit([this, id, promise, req = std::move(req), keepAlive] {
+            std::string response;
+            try {
+                response = serialize(handle(req), keepAlive);
+            } catch (const std::exception& e) {
+                response = serialize(message(500, e.what()), keepAlive);
+            }
+            promise->set_value(std::move(response));
+            {
+                std::lock_guard lock(doneMtx);
+                done.push_back(id);
+            }
+            std::uint64_t one = 1;
+            [[maybe_unused]] auto n = ::write(wakefd, &one, sizeof(one));
+        });
+    }
+
+    // 从输入缓冲区中解析尽可能多的完整请求（流水线）
+    void parse(std::uint64_t id, Connection& conn) {
+        std::size_t offset = 0;
+        while (!conn.closeAfter) {
+            std::string_view rest = std::string_view(conn.in).substr(offset);
+            auto headEnd = rest.find("\r\n\r\n");
+            if (headEnd == std::string_view::npos) {
+                if (rest.size() > HTTP_MAX_REQUEST_BYTES) {
+                    conn.pending.push_back(immediate(message(413, "请求头过大"), false));
+                    conn.closeAfter = true;
+                }
+                break;
+            }
+            std::string_view head = rest.substr(0, headEnd);
+            auto lineEnd = head.find("\r\n");
+            std::string_view requestLine = head.substr(0, lineEnd);
+            std::string_view fields = lineEnd == std::string_view::npos ? std::string_view() : head.substr(lineEnd + 2);
+
+            auto sp1 = requestLine.find(' ');
+            auto sp2 = requestLine.rfind(' ');
+            if (sp1 == std::string_view::npos || sp2 == sp1) {
+                conn.pending.push_back(immediate(message(400, "请求行格式错误"), false));
+                conn.closeAfter = true;
+                break;
+            }
+            std::string_view version = requestLine.substr(sp2 + 1);
+            if (header(fields, "Transfer-Encoding")) {
+                conn.pending.push_back(immediate(message(501, "不支持分块传输编码"), false));
+                conn.closeAfter = true;
+                break;
+            }
+            std::size_t length = 0;
+            if (auto cl = header(fields, "Content-Length")) {
+                auto [ptr, ec] = std::from_chars(cl->data(), cl->data() + cl->size(), length);
+                if (ec != std::errc() || ptr != cl->data() + cl->size()) {
+                    conn.pending.push_back(immediate(message(400, "Content-Length无效"), false));
+                    conn.closeAfter = true;
+                    break;
+                }
+            }
+            if (headEnd + 4 + length > HTTP_MAX_REQUEST_BYTES) {
+                conn.pending.push_back(immediate(message(413, "请求体过大"), false));
+                conn.closeAfter = true;
+                break;
+            }
+            if (rest.size() < headEnd + 4 + length) break;   // 请求体尚未收全
+
+            auto connection = header(fields, "Connection");
+            bool keepAlive = version == "HTTP/1.1" ? !(connection && iequals(*connection, "close"))
+                                                   : connection && iequals(*connection, "keep-alive");
+            Request req;
+            req.method = std::string(requestLine.substr(0, sp1));
+            std::string_view target = requestLine.substr(sp1 + 1, sp2 - sp1 - 1);
+            auto q = target.find('?');
+            for (auto seg : std::views::split(target.substr(0, q), '/')) {
+                if (seg.begin() != seg.end()) req.path.push_back(percentDecode(std::string_view(seg.begin(), seg.end())));
+            }
+            if (q != std::string_view::npos) parseParams(target.substr(q + 1), req.params);
+            if (length > 0) parseParams(rest.substr(headEnd + 4, length), req.params);
+
+            offset += headEnd + 4 + length;
+            dispatch(id, conn, std::move(req), keepAlive);
+            if (!keepAlive) conn.closeAfter = true;
+        }
+        conn.in.erase(0, offset);
+    }
+
+    static std::future<std::string> immediate(const Response& r, bool keepAlive) {
+        std::promise<std::string> ready;
+        ready.set_value(serialize(r, keepAlive));
+        return ready.get_future();
+    }
+
+    void read(std::uint64_t id, Connection& conn) {
+        char buf[16 * 1024];
+        while (true) {
+            ssize_t n = ::recv(conn.fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                if (!conn.closeAfter) conn.in.append(buf, static_cast<std::size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n == 0) {
+                // 对端关闭写方向：已收到的请求照常响应
+                conn.readClosed = true;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                close(id);
+                return;
+            }
+            break;
+        }
+        parse(id, conn);
+        if (conn.readClosed) conn.closeAfter = true;
+        flush(id, conn);
+    }
+
+    // 按顺序取出已就绪的响应并尽量写出；剩余数据等待EPOLLOUT
+    void flush(std::uint64_t id, Connection& conn) {
+        while (!conn.pending.empty() &&
+               conn.pending.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            conn.out += conn.pending.front().get();
+            conn.pending.pop_front();
+            ++served;
+        }
+        std::size_t sent = 0;
+        while (sent < conn.out.size()) {
+            ssize_t n = ::send(conn.fd, conn.out.data() + sent, conn.out.size() - sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                sent += static_cast<std::size_t>(n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else {
+                close(id);
+                return;
+            }
+        }
+        conn.out.erase(0, sent);
+        if (conn.out.empty() && conn.pending.empty() && conn.closeAfter) {
+            close(id);
+            return;
+        }
+        std::uint32_t events = (conn.readClosed ? 0u : std::uint32_t{EPOLLIN | EPOLLRDHUP}) |
+                               (conn.out.empty() ? 0u : std::uint32_t{EPOLLOUT});
+        if (events != conn.events) {
+            conn.events = events;
+            watch(conn.fd, id, events, EPOLL_CTL_MOD);
+        }
+    }
+
+    // 处理工作线程的完成通知
+    void drainCompletions() {
+        std::uint64_t count = 0;
+        [[maybe_unused]] auto n = ::read(wakefd, &count, sizeof(count));
+        std::vector<std::uint64_t> ids;
+        {
+            std::lock_guard lock(doneMtx);
+            ids.swap(done);
+        }
+        inflight -= ids.size();
+        std::ranges::sort(ids);
+        ids.erase(std::ranges::unique(ids).begin(), ids.end());
+        for (auto id : ids) {
+            auto it = conns.find(id);
+            if (it != conns.end()) flush(id, it->second);
+        }
+    }
+
+    std::optional<RequestExecutor> executor;
+
+public:
+    HttpServer(std::uint16_t port, std::size_t workers, std::size_t maxInflight = HTTP_MAX_INFLIGHT)
+        : port(port), workers(workers), maxInflight(std::max<std::size_t>(1, maxInflight)) {}
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    ~HttpServer() {
+        executor.reset();   // 先等待工作线程执行完剩余请求
+        for (auto& [id, conn] : conns) ::close(conn.fd);
+        for (int fd : {sigfd, wakefd, listenfd, epfd, sparefd}) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+
+    // 停止服务的信号：只经signalfd送达事件循环
+    static sigset_t shutdownSignals() {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        return mask;
+    }
+
+    // 在主线程创建任何线程之前调用：新线程继承屏蔽字，否则信号可能被后台线程（指标、SQL跟踪、
+    // 日志存储、合并写入等）按默认动作处理而直接终止进程
+    static void blockShutdownSignals() {
+        sigset_t mask = shutdownSignals();
+        if (int rc = pthread_sigmask(SIG_BLOCK, &mask, nullptr); rc != 0) {
+            throw std::runtime_error("屏蔽信号失败：" + std::string(std::strerror(rc)));
+        }
+    }
+
+    // 运行到收到SIGINT/SIGTERM为止；调用前须已经blockShutdownSignals()
+    void run() {
+        executor.emplace(workers);
+        if (Storage::current().usesDatabase()) SeatAllocator::instance().start(SEAT_RECONCILE_INTERVAL);
+
+        sigset_t mask = shutdownSignals();
+        check(epfd = ::epoll_create1(EPOLL_CLOEXEC), "epoll_create1");
+        check(sigfd = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC), "signalfd");
+        check(wakefd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), "eventfd");
+        check(sparefd = ::open("/dev/null", O_RDONLY | O_CLOEXEC), "预留文件描述符");
+        check(listenfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0), "socket");
+        int one = 1;
+        ::setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        check(::bind(listenfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), "绑定端口");
+        check(::listen(listenfd, SOMAXCONN), "listen");
+        watch(listenfd, LISTENER, EPOLLIN);
+        watch(wakefd, WAKEUP, EPOLLIN);
+        watch(sigfd, SIGNALS, EPOLLIN);
+        std::clog << "服务已启动：http://127.0.0.1:" << port << "（工作线程 " << workers
+                  << " 个，在途上限 " << maxInflight << "），Ctrl+C停止" << std::endl;
+
+        std::array<epoll_event, 256> events;
+        bool running = true;
+        while (running) {
+            int n = ::epoll_wait(epfd, events.data(), static_cast<int>(events.size()), -1);
+            if (n < 0 && errno == EINTR) continue;
+            check(n, "epoll_wait");
+            for (int i = 0; i < n; ++i) {
+                std::uint64_t key = events[i].data.u64;
+                if (key == LISTENER) {
+                    accept();
+                } else if (key == WAKEUP) {
+                    drainCompletions();
+                } else if (key == SIGNALS) {
+                    running = false;
+                } else if (auto it = conns.find(key); it != conns.end()) {
+                    Connection& conn = it->second;
+                    if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                        close(key);
+                    } else if (events[i].events & (EPOLLIN | EPOLLRDHUP) && !conn.readClosed) {
+                        read(key, conn);
+                    } else if (events[i].events & EPOLLOUT) {
+                        flush(key, conn);
+                    }
+                }
+            }
+        }
+        std::clog << "服务已停止：共响应 " << served << " 个请求，因繁忙拒绝 " << rejected << " 个" << std::endl;
+    }
+};
+
 // ====================== 主函数 ======================
-int main() {
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    // 存储后端：20 --storage <postgres|memory|log> [模式及参数]，未指定时取环境变量STUDENT_SYS_STORAGE，默认postgres
+    if (args.size() >= 2 && args[0] == "--storage") {
+        Storage::backendName() = args[1];
+        args.erase(args.begin(), args.begin() + 2);
+    }
+    // 服务模式经signalfd处理SIGINT/SIGTERM，须在下面启动任何后台线程之前屏蔽；其他模式保留Ctrl+C的默认行为
+    if (!args.empty() && args[0] == "--serve") {
+        try {
+            HttpServer::blockShutdownSignals();
+        } catch (const std::exception& e) {
+            std::cerr << "服务启动失败：" << e.what() << '\n';
+            return 1;
+        }
+    }
+    // 设置STUDENT_SYS_METRICS时输出操作指标：退出时一次，运行中每收到SIGUSR1一次
+    if (const char* metrics = std::getenv("STUDENT_SYS_METRICS"); metrics && *metrics) {
+        Metrics::instance().enableReporting();
+    }
+    // 设置STUDENT_SYS_TRACE时记录每条SQL，慢语句附带执行计划（阈值与参数隐藏见SqlTrace::configFromEnv）
+    try {
+        if (auto trace = SqlTrace::configFromEnv()) SqlTrace::instance().enable(std::move(*trace));
+    } catch (const std::exception& e) {
+        std::cerr << "SQL跟踪开启失败：" << e.what() << '\n';
+        return 1;
+    }
+    try {
+        Storage::current();
+    } catch (const std::exception& e) {
+        std::cerr << "存储后端初始化失败：" << e.what() << '\n';
+        return 1;
+    }
+    // 以下模式直接使用数据库（COPY），只支持postgres后端
+    const std::unordered_set<std::string> databaseModes{"--import", "--gradebook"};
+    if (!args.empty() && databaseModes.contains(args[0]) && !Storage::current().usesDatabase()) {
+        std::cerr << args[0] << "模式只支持postgres存储后端\n";
+        return 1;
+    }
+    // 设置STUDENT_SYS_GROUP_COMMIT=间隔毫秒[,每批上限]时，并发的成绩录入与选课合并提交（见WriteCoalescer）
+    try {
+        if (auto groupCommit = WriteCoalescer::configFromEnv(); groupCommit && Storage::current().usesDatabase()) {
+            WriteCoalescer::instance().start(groupCommit->first, groupCommit->second);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "合并写入开启失败：" << e.what() << '\n';
+        return 1;
+    }
+    // 批量命令模式：20 --batch [命令文件|-] [--group N] [--workers N]
+    if (!args.empty() && args[0] == "--batch") {
+        const std::string usage = "用法：" + std::string(argv[0]) + " --batch [命令文件|-] [--group N] [--workers N]";
+        std::string path = "-";
+        std::size_t groupSize = 0, workers = 0;
+        for (std::size_t i = 1; i < args.size(); ++i) {
+            if ((args[i] == "--group" || args[i] == "--workers") && i + 1 < args.size()) {
+                std::size_t& value = args[i] == "--group" ? groupSize : workers;
+                auto [ptr, ec] = std::from_chars(args[i + 1].data(), args[i + 1].data() + args[i + 1].size(), value);
+                if (ec != std::errc()) {
+                    std::cerr << usage << '\n';
+                    return 1;
+                }
+                ++i;
+            } else {
+                path = args[i];
+            }
+        }
+        // 单线程时关闭与stdio的同步并解除cin与cout的绑定，输出只在缓冲区满或结束时写出；
+        // 多个工作线程同时输出时保留同步，由stdio加锁
+        if (workers == 0) std::ios::sync_with_stdio(false);
+        std::cin.tie(nullptr);
+        BatchRunner runner;
+        if (path == "-") return runner.run(std::cin, groupSize, workers) ? 0 : 1;
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "无法打开文件：" << path << '\n';
+            return 1;
+        }
+        return runner.run(file, groupSize, workers) ? 0 : 1;
+    }
+    // 服务模式：20 --serve [端口] [--workers N]
+    if (!args.empty() && args[0] == "--serve") {
+        std::uint16_t port = HTTP_PORT;
+        std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 1; i < args.size(); ++i) {
+            std::string_view arg = args[i];
+            std::from_chars_result parsed{};
+            if (arg == "--workers" && i + 1 < args.size()) {
+                arg = args[++i];
+                parsed = std::from_chars(arg.data(), arg.data() + arg.size(), workers);
+            } else {
+                parsed = std::from_chars(arg.data(), arg.data() + arg.size(), port);
+            }
+            if (parsed.ec != std::errc() || parsed.ptr != arg.data() + arg.size()) {
+                std::cerr << "用法：" << argv[0] << " --serve [端口] [--workers N]\n";
+                return 1;
+            }
+        }
+        // 仓库层的操作提示不输出，服务日志写到std::clog
+        std::cout.setstate(std::ios::badbit);
+        try {
+            HttpServer server(port, std::max<std::size_t>(1, workers));
+            server.run();
+        } catch (const std::exception& e) {
+            std::cerr << "服务启动失败：" << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    // 批量导入模式：20 --import <students|teachers|courses> <文件.csv>
+    if (!args.empty() && args[0] == "--import") {
+        if (args.size() < 3) {
+            std::cerr << "用法：" << argv[0] << " --import <students|teachers|courses> <文件.csv>\n";
+            return 1;
+        }
+        ImportController importCtrl;
+        return importCtrl.importFile(args[1], args[2]) ? 0 : 1;
+    }
+    // 成绩册上传模式：20 --gradebook <课程ID> <文件.csv>
+    if (!args.empty() && args[0] == "--gradebook") {
+        if (args.size() < 3) {
+            std::cerr << "用法：" << argv[0] << " --gradebook <课程ID> <文件.csv>\n";
+            return 1;
+        }
+        ImportController importCtrl;
+        return importCtrl.uploadGradebook(args[1], args[2]) ? 0 : 1;
+    }
 
     TerminalUI ui;
     ui.run();
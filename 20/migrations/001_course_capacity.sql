@@ -0,0 +1,16 @@
+-- 选课容量：courses.capacity为课程容量（NULL表示不限），courses.enrolled为已选人数，
+-- 由选课、退课及级联删除在同一事务内维护。程序启动时检查这两列，缺少时提示执行本脚本：
+--   psql "$STUDENT_SYS_DB" -f 20/migrations/001_course_capacity.sql
+-- 可重复执行：已有的列保留，enrolled按选课表重新回填。回填期间锁住两张表，避免与并发选课交错
+BEGIN;
+
+LOCK TABLE courses, enrollments IN SHARE ROW EXCLUSIVE MODE;
+
+ALTER TABLE courses
+    ADD COLUMN IF NOT EXISTS capacity integer,
+    ADD COLUMN IF NOT EXISTS enrolled integer NOT NULL DEFAULT 0;
+
+UPDATE courses c
+SET enrolled = (SELECT count(*) FROM enrollments e WHERE e.course_id = c.id);
+
+COMMIT;
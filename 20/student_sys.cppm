@@ -0,0 +1,3876 @@
+// 学生选课管理系统公共模块：领域层、工具类与仓库层。
+// 交互程序20、负载生成器loadgen等可执行目标共用，各自只包含自己的表现层与入口
+module;
+#include <pqxx/pqxx>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+export module student_sys;
+import std;
+
+export {
+
+// 全局常量：封装数据库连接参数，避免硬编码（导出的常量须为inline，const变量默认内部链接）
+inline const std::string DB_CONN_STR = "dbname=student_sys user=postgres password=123456 host=localhost port=5432";
+inline const int TABLE_WIDTH = 15; // 格式化输出列宽
+inline const std::size_t DB_POOL_SIZE = 4; // 连接池最大连接数
+inline const auto DB_POOL_WAIT_TIMEOUT = std::chrono::seconds(10); // 借用连接的最长等待时间
+inline const std::size_t DB_FETCH_SIZE = 1000; // 流式查询每批拉取的行数
+inline const auto SEAT_RECONCILE_INTERVAL = std::chrono::seconds(30); // 选课名额内存计数与选课表的对账周期
+inline const auto GROUP_COMMIT_INTERVAL = std::chrono::milliseconds(5); // 合并写入的最长攒批时间
+inline const std::size_t GROUP_COMMIT_MAX_OPS = 256; // 攒够该数量的写入时立即提交
+inline const std::string LOG_STORAGE_PATH = "student_sys.data"; // 本地日志存储的数据文件
+inline const std::size_t LOG_GROW_BYTES = std::size_t{64} << 20; // 数据文件每次扩展的字节数
+inline const std::size_t LOG_COMPACT_MIN_BYTES = std::size_t{64} << 20; // 日志小于该值时不压缩
+inline const std::size_t LOG_COMPACT_RATIO = 2; // 日志超过上次压缩后大小的倍数时压缩
+inline const auto LOG_COMPACT_INTERVAL = std::chrono::seconds(60); // 检查是否需要压缩的周期
+
+// ====================== 领域层（实体类）======================
+class Student {
+private:
+    std::string id;
+    std::string name;
+    std::string major;
+public:
+    Student(std::string id, std::string name, std::string major)
+        : id(std::move(id)), name(std::move(name)), major(std::move(major)) {}
+
+    const std::string& getId() const { return id; }
+    const std::string& getName() const { return name; }
+    const std::string& getMajor() const { return major; }
+};
+
+class Teacher {
+private:
+    std::string id;
+    std::string name;
+    std::string department;
+public:
+    Teacher(std::string id, std::string name, std::string department)
+        : id(std::move(id)), name(std::move(name)), department(std::move(department)) {}
+
+    const std::string& getId() const { return id; }
+    const std::string& getName() const { return name; }
+    const std::string& getDepartment() const { return department; }
+};
+
+class Course {
+private:
+    std::string id;
+    std::string name;
+    int credit;
+    std::string teacherId;
+public:
+    Course(std::string id, std::string name, int credit, std::string teacherId)
+        : id(std::move(id)), name(std::move(name)), credit(credit), teacherId(std::move(teacherId)) {}
+
+    const std::string& getId() const { return id; }
+    const std::string& getName() const { return name; }
+    int getCredit() const { return credit; }
+    const std::string& getTeacherId() const { return teacherId; }
+};
+
+class Score {
+private:
+    std::string studentId;
+    std::string courseId;
+    double score;
+public:
+    Score(std::string studentId, std::string courseId, double score)
+        : studentId(std::move(studentId)), courseId(std::move(courseId)), score(score) {}
+
+    const std::string& getStudentId() const { return studentId; }
+    const std::string& getCourseId() const { return courseId; }
+    double getScore() const { return score; }
+    void setScore(double s) { score = s; }
+};
+
+// 选课结果
+enum class EnrollResult {
+    Ok,               // 选课成功
+    NoSuchStudent,    // 学生不存在
+    NoSuchCourse,     // 课程不存在
+    AlreadyEnrolled,  // 已选该课程
+    CourseFull        // 课程已满
+};
+
+inline std::string describe(EnrollResult result, const std::string& studentId, const std::string& courseId) {
+    switch (result) {
+        case EnrollResult::Ok: return "学生【" + studentId + "】选课【" + courseId + "】成功！";
+        case EnrollResult::NoSuchStudent: return "选课失败：学生ID【" + studentId + "】不存在";
+        case EnrollResult::NoSuchCourse: return "选课失败：课程ID【" + courseId + "】不存在";
+        case EnrollResult::AlreadyEnrolled: return "选课失败：已选该课程，无需重复选课";
+        case EnrollResult::CourseFull: return "选课失败：课程【" + courseId + "】已满";
+    }
+    return "选课失败：未知结果";
+}
+
+// 成绩录入结果
+enum class ScoreResult {
+    Ok,               // 录入/更新成功
+    NoSuchStudent,    // 学生不存在
+    NoSuchCourse,     // 课程不存在
+    NotEnrolled       // 学生未选该课程
+};
+
+inline std::string describe(ScoreResult result, const std::string& studentId, const std::string& courseId) {
+    switch (result) {
+        case ScoreResult::Ok: return "成绩录入/更新成功！";
+        case ScoreResult::NoSuchStudent: return "成绩操作失败：学生ID【" + studentId + "】不存在";
+        case ScoreResult::NoSuchCourse: return "成绩操作失败：课程ID【" + courseId + "】不存在";
+        case ScoreResult::NotEnrolled: return "成绩操作失败：学生未选该课程，无法录入成绩";
+    }
+    return "成绩操作失败：未知结果";
+}
+
+// 成绩单中的一门课程
+class TranscriptEntry {
+private:
+    std::string courseId;
+    std::string courseName;
+    int credit;
+    double score;
+public:
+    TranscriptEntry(std::string courseId, std::string courseName, int credit, double score)
+        : courseId(std::move(courseId)), courseName(std::move(courseName)), credit(credit), score(score) {}
+
+    const std::string& getCourseId() const { return courseId; }
+    const std::string& getCourseName() const { return courseName; }
+    int getCredit() const { return credit; }
+    double getScore() const { return score; }
+};
+
+// 学生成绩单：学生信息、各课程成绩及平均分汇总
+class Transcript {
+private:
+    Student student;
+    std::vector<TranscriptEntry> entries;
+    double average;
+    double weightedAverage;
+public:
+    Transcript(Student student, std::vector<TranscriptEntry> entries, double average, double weightedAverage)
+        : student(std::move(student)), entries(std::move(entries)), average(average), weightedAverage(weightedAverage) {}
+
+    const Student& getStudent() const { return student; }
+    const std::vector<TranscriptEntry>& getEntries() const { return entries; }
+    double getAverage() const { return average; }
+    double getWeightedAverage() const { return weightedAverage; }
+};
+
+// 级联删除的影响行数
+struct CascadeDeleteResult {
+    std::size_t scores = 0;       // 删除的成绩记录数
+    std::size_t enrollments = 0;  // 删除的选课记录数
+    std::size_t batches = 1;      // 执行的事务数（分批模式下大于1）
+};
+
+// ====================== 存储后端接口 ======================
+// 五个仓库的数据读写都经由当前存储后端完成：PostgresStorage（默认）、MemoryStorage（纯内存）
+// 或LogStorage（内存映射的本地日志文件）。
+// 后端只负责数据访问与一致性约束（插入ID已存在时忽略、删除级联、选课容量），
+// 操作提示与错误信息前缀由仓库层给出；“不存在”等预期情况通过返回值表示，其余错误抛异常
+class Storage {
+public:
+    virtual ~Storage() = default;
+
+    // 后端名称（postgres|memory|log）：环境变量STUDENT_SYS_STORAGE优先，需在首次调用current()前修改
+    static std::string& backendName();
+    static Storage& current();
+
+    virtual std::string_view name() const = 0;
+    // 是否经由数据库连接访问数据：执行器据此为工作线程绑定连接，批量事务与名额对账只在数据库后端上进行
+    virtual bool usesDatabase() const = 0;
+
+    // 学生（列表按ID排序，下同）
+    virtual void insertStudent(const Student& student) = 0;
+    virtual std::optional<Student> findStudent(const std::string& id) = 0;
+    virtual std::vector<Student> listStudents() = 0;
+    virtual void forEachStudent(const std::function<void(const Student&)>& fn, std::size_t fetchSize) = 0;
+    virtual std::optional<CascadeDeleteResult> deleteStudent(const std::string& id) = 0;   // 学生不存在时为空
+
+    // 教师
+    virtual void insertTeacher(const Teacher& teacher) = 0;
+    virtual std::optional<Teacher> findTeacher(const std::string& id) = 0;
+
+    // 课程
+    virtual void insertCourse(const Course& course) = 0;
+    virtual std::optional<Course> findCourse(const std::string& id) = 0;
+    virtual std::vector<Course> findCourses(std::span<const std::string> ids) = 0;      // 忽略不存在的ID
+    virtual std::vector<Course> listCourses() = 0;
+    virtual void forEachCourse(const std::function<void(const Course&)>& fn, std::size_t fetchSize) = 0;
+    virtual bool setCapacity(const std::string& id, std::optional<int> capacity) = 0;   // 课程不存在时返回false
+    virtual std::optional<CascadeDeleteResult> deleteCourse(const std::string& id, std::size_t chunkSize) = 0;
+
+    // 成绩（按课程ID排序）；成绩单在学生不存在时为空，无成绩时条目为空
+    virtual ScoreResult setScore(const Score& score) = 0;
+    virtual std::vector<Score> listScores(const std::string& studentId) = 0;
+    virtual std::optional<Transcript> transcript(const std::string& studentId) = 0;
+
+    // 选课
+    virtual EnrollResult enroll(const std::string& studentId, const std::string& courseId) = 0;
+    virtual bool dropCourse(const std::string& studentId, const std::string& courseId) = 0;   // 未选该课程时返回false
+    virtual std::vector<Course> listEnrolledCourses(const std::string& studentId) = 0;
+};
+
+// ====================== 工具类：数据库连接+输入处理 ======================
+class ConnectionPool;
+
+// 数据库连接工具：封装连接创建，避免重复代码
+class DBUtil {
+public:
+    // 连接参数：环境变量STUDENT_SYS_DB优先于DB_CONN_STR；需在首次建立连接前修改（如基准测试切换schema）
+    static std::string& connectionString() {
+        static std::string value = [] {
+            const char* env = std::getenv("STUDENT_SYS_DB");
+            return env && *env ? std::string(env) : DB_CONN_STR;
+        }();
+        return value;
+    }
+
+    static pqxx::connection createConn() {
+        try {
+            pqxx::connection conn(connectionString());
+            if (conn.is_open()) {
+                return conn;
+            } else {
+                throw std::runtime_error("数据库连接失败：连接未打开");
+            }
+        } catch (const pqxx::sql_error& e) {
+            throw std::runtime_error("SQL错误：" + std::string(e.what()) + " | SQL：" + e.query());
+        } catch (const std::exception& e) {
+            throw std::runtime_error("数据库连接错误：" + std::string(e.what()));
+        }
+    }
+
+    // 全局连接池：所有仓库共享，按操作借用连接
+    static ConnectionPool& pool();
+
+    // 当前线程累计的数据库往返次数（BEGIN/COMMIT、每条语句、首次预编译各计一次），
+    // 操作前后取差值即为该操作的往返次数
+    static std::uint64_t& roundTrips() {
+        thread_local std::uint64_t count = 0;
+        return count;
+    }
+
+    // 当前线程累计从数据库返回的行数，用法同roundTrips()
+    static std::uint64_t& rowsReturned() {
+        thread_local std::uint64_t count = 0;
+        return count;
+    }
+};
+
+// 多语句只读报表使用的快照事务：可重复读+只读，所有语句看到同一时刻的数据
+using ReadSnapshot = pqxx::transaction<pqxx::isolation_level::repeatable_read, pqxx::write_policy::read_only>;
+
+// 仓库操作的事务句柄：独立事务，或批量事务中的保存点
+class DbTxn {
+private:
+    std::unique_ptr<pqxx::transaction_base> txn;
+public:
+    explicit DbTxn(std::unique_ptr<pqxx::transaction_base> txn) : txn(std::move(txn)) {}
+
+    operator pqxx::transaction_base&() const { return *txn; }
+    pqxx::transaction_base* operator->() const { return txn.get(); }
+};
+
+// SQL语句注册表：集中登记仓库使用的全部SQL，以固定名称在每条连接上预编译一次
+class SqlRegistry {
+public:
+    // 按名称查找SQL文本，未登记的名称视为编程错误
+    static std::string_view get(std::string_view name) {
+        return entry(name).second;
+    }
+
+    // 按名称查找登记项；返回的名称指向注册表内的静态字符串，可长期保存
+    static const std::pair<const std::string_view, std::string_view>& entry(std::string_view name) {
+        auto it = statements().find(name);
+        if (it == statements().end()) {
+            throw std::runtime_error("未登记的SQL语句：" + std::string(name));
+        }
+        return *it;
+    }
+
+private:
+    static const std::unordered_map<std::string_view, std::string_view>& statements() {
+        static const std::unordered_map<std::string_view, std::string_view> table = {
+            // 学生
+            {"student_insert", "INSERT INTO students (id, name, major) VALUES ($1, $2, $3) ON CONFLICT (id) DO NOTHING"},
+            {"student_get_by_id", "SELECT id, name, major FROM students WHERE id = $1"},
+            {"student_list", "SELECT id, name, major FROM students ORDER BY id"},
+            // 成绩、选课、学生在同一条语句中删除，外键检查在语句结束时进行；deleted为0表示学生不存在。
+            // 每门退掉的课程一行（course_id，无选课时为一行NULL），供SeatAllocator归还名额
+            {"student_delete_cascade", "WITH s AS (DELETE FROM scores WHERE student_id = $1 RETURNING 1), "
+                                       "e AS (DELETE FROM enrollments WHERE student_id = $1 RETURNING course_id), "
+                                       "u AS (UPDATE courses SET enrolled = enrolled - 1 WHERE id IN (SELECT course_id FROM e)), "
+                                       "d AS (DELETE FROM students WHERE id = $1 RETURNING 1) "
+                                       "SELECT (SELECT count(*) FROM d) AS deleted, (SELECT count(*) FROM s) AS scores, "
+                                       "(SELECT count(*) FROM e) AS enrollments, e.course_id "
+                                       "FROM (VALUES (1)) one LEFT JOIN e ON true"},
+            // 教师
+            {"teacher_insert", "INSERT INTO teachers (id, name, department) VALUES ($1, $2, $3) ON CONFLICT (id) DO NOTHING"},
+            {"teacher_get_by_id", "SELECT id, name, department FROM teachers WHERE id = $1"},
+            // 课程
+            {"course_insert", "INSERT INTO courses (id, name, credit, teacher_id) VALUES ($1, $2, $3, $4) ON CONFLICT (id) DO NOTHING"},
+            {"course_get_by_id", "SELECT id, name, credit, teacher_id FROM courses WHERE id = $1"},
+            {"course_list", "SELECT id, name, credit, teacher_id FROM courses ORDER BY id"},
+            // 课程容量：capacity为NULL表示不限；enrolled为已选人数，随选课/退课在同一事务内增减
+            {"course_set_capacity", "UPDATE courses SET capacity = $2 WHERE id = $1"},
+            {"course_seats", "SELECT c.id, c.capacity, count(e.student_id) AS enrolled FROM courses c "
+                             "LEFT JOIN enrollments e ON e.course_id = c.id "
+                             "WHERE c.capacity IS NOT NULL GROUP BY c.id, c.capacity"},
+            {"course_seat_check", "SELECT c.capacity, c.enrolled, "
+                                  "(SELECT count(*) FROM enrollments e WHERE e.course_id = c.id) AS actual "
+                                  "FROM courses c WHERE c.id = $1"},
+            {"course_get_by_ids", "SELECT id, name, credit, teacher_id FROM courses WHERE id = ANY($1::text[]) ORDER BY id"},
+            {"course_delete_cascade", "WITH s AS (DELETE FROM scores WHERE course_id = $1 RETURNING 1), "
+                                      "e AS (DELETE FROM enrollments WHERE course_id = $1 RETURNING 1), "
+                                      "d AS (DELETE FROM courses WHERE id = $1 RETURNING 1) "
+                                      "SELECT (SELECT count(*) FROM d) AS deleted, (SELECT count(*) FROM s) AS scores, "
+                                      "(SELECT count(*) FROM e) AS enrollments"},
+            // 分批删除：每批最多$2个学生的选课及成绩，SKIP LOCKED跳过正被其他事务持有的行，留给后续批次
+            {"course_delete_chunk", "WITH v AS (SELECT student_id FROM enrollments WHERE course_id = $1 "
+                                    "LIMIT $2 FOR UPDATE SKIP LOCKED), "
+                                    "s AS (DELETE FROM scores sc USING v WHERE sc.course_id = $1 AND sc.student_id = v.student_id RETURNING 1), "
+                                    "e AS (DELETE FROM enrollments en USING v WHERE en.course_id = $1 AND en.student_id = v.student_id RETURNING 1) "
+                                    "SELECT (SELECT count(*) FROM s) AS scores, (SELECT count(*) FROM e) AS enrollments"},
+            // 成绩
+            // 成绩录入：仅在选课记录存在时upsert；锁住选课行（FOR KEY SHARE）防止并发退课
+            {"score_set", "WITH s AS (SELECT EXISTS (SELECT 1 FROM students WHERE id = $1) AS ok), "
+                          "c AS (SELECT EXISTS (SELECT 1 FROM courses WHERE id = $2) AS ok), "
+                          "e AS (SELECT 1 FROM enrollments WHERE student_id = $1 AND course_id = $2 FOR KEY SHARE), "
+                          "up AS (INSERT INTO scores (student_id, course_id, score) "
+                          "       SELECT $1, $2, $3 WHERE EXISTS (SELECT 1 FROM e) "
+                          "       ON CONFLICT (student_id, course_id) DO UPDATE SET score = EXCLUDED.score RETURNING 1) "
+                          "SELECT (SELECT ok FROM s) AS student_ok, (SELECT ok FROM c) AS course_ok, "
+                          "EXISTS (SELECT 1 FROM e) AS enrolled, EXISTS (SELECT 1 FROM up) AS written"},
+            // 合并录入（见WriteCoalescer）：$1/$2/$3为按到达顺序排列的学生ID、课程ID、成绩数组，每个输入返回一行校验结果；
+            // 同一批中对同一（学生, 课程）的多次录入以最后一次为准
+            {"score_set_batch", "WITH i AS (SELECT * FROM unnest($1::text[], $2::text[], $3::float8[]) "
+                                "           WITH ORDINALITY AS t(student_id, course_id, score, ord)), "
+                                "e AS (SELECT student_id, course_id FROM enrollments "
+                                "      WHERE (student_id, course_id) IN (SELECT student_id, course_id FROM i) FOR KEY SHARE), "
+                                "up AS (INSERT INTO scores (student_id, course_id, score) "
+                                "       SELECT DISTINCT ON (i.student_id, i.course_id) i.student_id, i.course_id, i.score "
+                                "       FROM i JOIN e USING (student_id, course_id) ORDER BY i.student_id, i.course_id, i.ord DESC "
+                                "       ON CONFLICT (student_id, course_id) DO UPDATE SET score = EXCLUDED.score) "
+                                "SELECT i.ord, EXISTS (SELECT 1 FROM students s WHERE s.id = i.student_id) AS student_ok, "
+                                "EXISTS (SELECT 1 FROM courses c WHERE c.id = i.course_id) AS course_ok, "
+                                "EXISTS (SELECT 1 FROM e WHERE e.student_id = i.student_id AND e.course_id = i.course_id) AS enrolled "
+                                "FROM i ORDER BY i.ord"},
+            {"score_list_by_student", "SELECT student_id, course_id, score FROM scores WHERE student_id = $1 ORDER BY course_id"},
+            // 成绩单：学生不存在时无结果行；无成绩时返回一行课程列为空；平均分由窗口函数在服务端计算
+            {"score_transcript", "SELECT s.id, s.name, s.major, c.id AS course_id, c.name AS course_name, c.credit, "
+                                 "sc.score::float8 AS score, "
+                                 "(AVG(sc.score) OVER ())::float8 AS avg_score, "
+                                 "(SUM(sc.score * c.credit) OVER () / NULLIF(SUM(c.credit) OVER (), 0))::float8 AS weighted_avg "
+                                 "FROM students s "
+                                 "LEFT JOIN (scores sc JOIN courses c ON c.id = sc.course_id) ON sc.student_id = s.id "
+                                 "WHERE s.id = $1 ORDER BY c.id"},
+            // 选课
+            {"enrollment_get", "SELECT student_id, course_id FROM enrollments WHERE student_id = $1 AND course_id = $2"},
+            // 选课：存在性校验、重复检测与插入在同一语句内完成，依赖enrollments(student_id, course_id)唯一约束防止并发重复
+            // 先以条件UPDATE占座：并发时UPDATE在课程行锁释放后按最新版本重新判断enrolled < capacity，
+            // 容量不会被超出；占座成功才插入选课记录。inserted为false时调用方回滚事务，撤销占座
+            {"enrollment_enroll", "WITH s AS (SELECT EXISTS (SELECT 1 FROM students WHERE id = $1) AS ok), "
+                                  "c AS (SELECT EXISTS (SELECT 1 FROM courses WHERE id = $2) AS ok), "
+                                  "dup AS (SELECT EXISTS (SELECT 1 FROM enrollments WHERE student_id = $1 AND course_id = $2) AS ok), "
+                                  "seat AS (UPDATE courses SET enrolled = enrolled + 1 "
+                                  "         WHERE id = $2 AND (capacity IS NULL OR enrolled < capacity) "
+                                  "         AND (SELECT ok FROM s) AND NOT (SELECT ok FROM dup) RETURNING 1), "
+                                  "ins AS (INSERT INTO enrollments (student_id, course_id) "
+                                  "        SELECT $1, $2 WHERE EXISTS (SELECT 1 FROM seat) "
+                                  "        ON CONFLICT (student_id, course_id) DO NOTHING RETURNING 1) "
+                                  "SELECT (SELECT ok FROM s) AS student_ok, (SELECT ok FROM c) AS course_ok, "
+                                  "(SELECT ok FROM dup) AS duplicate, EXISTS (SELECT 1 FROM seat) AS seated, "
+                                  "EXISTS (SELECT 1 FROM ins) AS inserted"},
+            // 合并选课（见WriteCoalescer）：按ID顺序锁住涉及的课程行，取得最新的已选人数；
+            // 每门课程的有效请求按到达顺序依次占用剩余名额，同一批中重复的请求只有第一个有效。
+            // 与并发事务插入冲突的请求占了名额但未插入（inserted为false），已选人数只按实际插入数增加
+            {"enrollment_enroll_batch", "WITH i AS (SELECT * FROM unnest($1::text[], $2::text[]) "
+                                        "           WITH ORDINALITY AS t(student_id, course_id, ord)), "
+                                        "c AS (SELECT id, capacity, enrolled FROM courses "
+                                        "      WHERE id IN (SELECT course_id FROM i) ORDER BY id FOR UPDATE), "
+                                        "v AS (SELECT i.student_id, i.course_id, i.ord, "
+                                        "             EXISTS (SELECT 1 FROM students s WHERE s.id = i.student_id) AS student_ok, "
+                                        "             c.id IS NOT NULL AS course_ok, "
+                                        "             EXISTS (SELECT 1 FROM enrollments e WHERE e.student_id = i.student_id "
+                                        "                     AND e.course_id = i.course_id) "
+                                        "             OR row_number() OVER (PARTITION BY i.student_id, i.course_id ORDER BY i.ord) > 1 "
+                                        "             AS duplicate, c.capacity, c.enrolled "
+                                        "      FROM i LEFT JOIN c ON c.id = i.course_id), "
+                                        "a AS (SELECT ord, student_id, course_id FROM "
+                                        "        (SELECT v.*, row_number() OVER (PARTITION BY course_id ORDER BY ord) AS seat FROM v "
+                                        "         WHERE student_ok AND course_ok AND NOT duplicate) w "
+                                        "      WHERE capacity IS NULL OR enrolled + seat <= capacity), "
+                                        "ins AS (INSERT INTO enrollments (student_id, course_id) SELECT student_id, course_id FROM a "
+                                        "        ON CONFLICT (student_id, course_id) DO NOTHING RETURNING student_id, course_id), "
+                                        "u AS (UPDATE courses SET enrolled = courses.enrolled + n.seats "
+                                        "      FROM (SELECT course_id, count(*) AS seats FROM ins GROUP BY course_id) n "
+                                        "      WHERE courses.id = n.course_id) "
+                                        "SELECT v.ord, v.student_ok, v.course_ok, v.duplicate, "
+                                        "EXISTS (SELECT 1 FROM a WHERE a.ord = v.ord) AS seated, "
+                                        "NOT v.duplicate AND EXISTS (SELECT 1 FROM ins WHERE ins.student_id = v.student_id "
+                                        "                            AND ins.course_id = v.course_id) AS inserted "
+                                        "FROM v ORDER BY v.ord"},
+            {"enrollment_delete_score", "DELETE FROM scores WHERE student_id = $1 AND course_id = $2"},
+            // 返回实际删除的选课行数，删除与计数扣减在同一语句内，未选该课程时为0
+            {"enrollment_delete", "WITH d AS (DELETE FROM enrollments WHERE student_id = $1 AND course_id = $2 RETURNING course_id), "
+                                  "u AS (UPDATE courses SET enrolled = enrolled - 1 WHERE id IN (SELECT course_id FROM d)) "
+                                  "SELECT count(*) AS deleted FROM d"},
+            {"enrollment_list_courses", "SELECT c.id, c.name, c.credit, c.teacher_id FROM enrollments e "
+                                        "JOIN courses c ON c.id = e.course_id WHERE e.student_id = $1 ORDER BY c.id"},
+            // 内存目录：$1为上次刷新时快照的xmin（xid文本），为NULL时全量加载；
+            // age(xmin) <= age($1)即该行在上次快照之后（或当时仍未结束的事务中）被插入/更新。
+            // id_hash与catalog_checksums中的和用于发现删除：目录中ID的个数与hashtext之和须与表中一致
+            {"catalog_watermark", "SELECT (txid_snapshot_xmin(txid_current_snapshot()) % 4294967296)::text AS xid"},
+            {"catalog_students_since", "SELECT id, name, major, hashtext(id) AS id_hash FROM students "
+                                       "WHERE $1::text IS NULL OR age(xmin) <= age($1::text::xid)"},
+            {"catalog_teachers_since", "SELECT id, name, department, hashtext(id) AS id_hash FROM teachers "
+                                       "WHERE $1::text IS NULL OR age(xmin) <= age($1::text::xid)"},
+            {"catalog_courses_since", "SELECT id, name, credit, teacher_id, hashtext(id) AS id_hash FROM courses "
+                                      "WHERE $1::text IS NULL OR age(xmin) <= age($1::text::xid)"},
+            {"catalog_checksums", "SELECT s.n AS students, s.h AS students_hash, t.n AS teachers, t.h AS teachers_hash, "
+                                  "c.n AS courses, c.h AS courses_hash FROM "
+                                  "(SELECT count(*) AS n, coalesce(sum(hashtext(id)), 0) AS h FROM students) s, "
+                                  "(SELECT count(*) AS n, coalesce(sum(hashtext(id)), 0) AS h FROM teachers) t, "
+                                  "(SELECT count(*) AS n, coalesce(sum(hashtext(id)), 0) AS h FROM courses) c"},
+        };
+        return table;
+    }
+};
+
+// SQL跟踪：开启后记录经仓库执行的每条语句（名称或SQL文本、参数、耗时、行数、错误）。
+// 执行线程只把记录放入有界环形缓冲区，由后台写线程取出并按每条一行JSON写入日志；
+// 耗时超过阈值的语句由写线程在独立连接上以EXPLAIN (ANALYZE, BUFFERS)重放后回滚，执行计划写在同一条记录中
+class SqlTrace {
+public:
+    struct Config {
+        std::string path;                                       // 日志文件，"-"表示标准错误
+        std::chrono::microseconds slowThreshold = std::chrono::milliseconds(100); // 慢语句阈值
+        bool redact = false;                                    // 日志中隐藏参数值（重放计划时仍使用原值）
+        std::size_t capacity = 4096;                            // 环形缓冲区容量，写满时丢弃新记录
+    };
+
+    struct Record {
+        std::chrono::system_clock::time_point at;
+        std::string name;                                       // 已登记语句的名称，动态SQL为空
+        std::string sql;                                        // 动态SQL文本，已登记语句为空（按名称查找）
+        std::vector<std::optional<std::string>> params{};       // 参数文本，NULL为空
+        std::chrono::microseconds duration{0};
+        std::size_t rows = 0;                                   // 返回行数，无结果集的写语句为影响行数
+        std::string error{};
+    };
+
+private:
+    Config config;
+    std::ofstream file;
+    std::ostream* out = nullptr;
+    std::unique_ptr<pqxx::connection> explainConn;             // 写线程专用，用于重放慢语句
+
+    std::mutex mtx;
+    std::condition_variable_any ready;
+    std::vector<Record> ring;
+    std::size_t head = 0;
+    std::size_t count = 0;
+    std::uint64_t dropped = 0;
+    std::jthread writer;                                        // 最后声明：析构时先停止并排空缓冲区
+
+    static std::atomic<bool>& active() {
+        static std::atomic<bool> flag{false};
+        return flag;
+    }
+
+    template<typename T>
+    static std::optional<std::string> param(const T& value) {
+        if (pqxx::is_null(value)) return std::nullopt;
+        return pqxx::to_string(value);
+    }
+
+    void push(Record&& record) {
+        {
+            std::lock_guard lock(mtx);
+            if (count == ring.size()) {
+                ++dropped;
+                return;
+            }
+            ring[(head + count) % ring.size()] = std::move(record);
+            ++count;
+        }
+        ready.notify_one();
+    }
+
+    // 取出缓冲区中的全部记录并写入日志；收到停止请求后排空剩余记录再退出
+    void drain(std::stop_token stop) {
+        std::vector<Record> batch;
+        while (true) {
+            std::uint64_t lost = 0;
+            {
+                std::unique_lock lock(mtx);
+                ready.wait(lock, stop, [this] { return count > 0; });
+                if (count == 0) return;
+                batch.clear();
+                for (; count > 0; --count, head = (head + 1) % ring.size()) batch.push_back(std::move(ring[head]));
+                lost = std::exchange(dropped, 0);
+            }
+            std::string text;
+            for (const auto& record : batch) text += format(record) + "\n";
+            if (lost > 0) text += std::format("{{\"dropped\":{}}}\n", lost);
+            *out << text << std::flush;
+        }
+    }
+
+    // 只重放查询与增删改语句；游标、DDL等不捕获执行计划
+    static bool explainable(std::string_view sql) {
+        auto start = sql.find_first_not_of(" \t\n(");
+        if (start == std::string_view::npos) return false;
+        std::string word;
+        for (char ch : sql.substr(start, 8)) {
+            if (!std::isalpha(static_cast<unsigned char>(ch))) break;
+            word += static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+        }
+        return word == "SELECT" || word == "WITH" || word == "INSERT" || word == "UPDATE" || word == "DELETE";
+    }
+
+    // 在独立事务中执行EXPLAIN (ANALYZE, BUFFERS)并回滚，写语句的副作用不会保留；
+    // 锁等待与执行时间设上限，避免与仍未提交的原事务互相阻塞。依赖会话状态（如临时表）的语句会捕获失败
+    std::string explain(const Record& record) {
+        std::string sql = record.name.empty() ? record.sql : std::string(SqlRegistry::get(record.name));
+        if (!explainable(sql)) return {};
+        try {
+            if (!explainConn) explainConn = std::make_unique<pqxx::connection>(DBUtil::createConn());
+            pqxx::params params;
+            for (const auto& value : record.params) params.append(value);
+            pqxx::work txn(*explainConn);
+            txn.exec("SET LOCAL lock_timeout = '1s'");
+            txn.exec("SET LOCAL statement_timeout = '30s'");
+            std::string plan;
+            for (const auto& row : txn.exec_params("EXPLAIN (ANALYZE, BUFFERS) " + sql, params)) {
+                plan += row[0].as<std::string>() + "\n";
+            }
+            txn.abort();
+            return plan;
+        } catch (const std::exception& e) {
+            if (explainConn && !explainConn->is_open()) explainConn.reset();
+            return "执行计划捕获失败：" + std::string(e.what());
+        }
+    }
+
+    std::string format(const Record& record) {
+        std::string line = std::format("{{\"at\":\"{:%FT%T}Z\",\"statement\":\"{}\"",
+                                       std::chrono::time_point_cast<std::chrono::microseconds>(record.at),
+                                       escape(record.name.empty() ? record.sql : record.name));
+        if (config.redact) {
+            line += std::format(",\"params\":\"<{}个参数已隐藏>\"", record.params.size());
+        } else {
+            line += ",\"params\":[";
+            for (std::size_t i = 0; i < record.params.size(); ++i) {
+                if (i > 0) line += ",";
+                line += record.params[i] ? "\"" + escape(*record.params[i]) + "\"" : "null";
+            }
+            line += "]";
+        }
+        line += std::format(",\"duration_us\":{},\"rows\":{}", record.duration.count(), record.rows);
+        if (!record.error.empty()) line += ",\"error\":\"" + escape(record.error) + "\"";
+        if (record.duration >= config.slowThreshold) {
+            line += ",\"slow\":true";
+            if (std::string plan = explain(record); !plan.empty()) line += ",\"plan\":\"" + escape(plan) + "\"";
+        }
+        return line + "}";
+    }
+
+    static std::string escape(std::string_view text) {
+        std::string result;
+        result.reserve(text.size());
+        for (char ch : text) {
+            switch (ch) {
+                case '"': result += "\\\""; break;
+                case '\\': result += "\\\\"; break;
+                case '\n': result += "\\n"; break;
+                case '\t': result += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(ch) < 0x20) result += std::format("\\u{:04x}", static_cast<int>(ch));
+                    else result += ch;
+            }
+        }
+        return result;
+    }
+
+public:
+    static SqlTrace& instance() {
+        static SqlTrace trace;
+        return trace;
+    }
+
+    ~SqlTrace() { active().store(false, std::memory_order_relaxed); }
+
+    // 未开启时执行路径上只多一次原子读
+    static bool enabled() { return active().load(std::memory_order_relaxed); }
+
+    // 从环境变量读取配置：STUDENT_SYS_TRACE为日志文件（未设置则不开启），
+    // STUDENT_SYS_TRACE_SLOW_MS为慢语句阈值（毫秒），STUDENT_SYS_TRACE_REDACT非空时隐藏参数
+    static std::optional<Config> configFromEnv() {
+        const char* path = std::getenv("STUDENT_SYS_TRACE");
+        if (!path || !*path) return std::nullopt;
+        Config config{.path = path};
+        if (const char* slow = std::getenv("STUDENT_SYS_TRACE_SLOW_MS"); slow && *slow) {
+            try {
+                config.slowThreshold = std::chrono::milliseconds(std::stol(slow));
+            } catch (const std::exception& e) {
+                throw std::runtime_error("慢语句阈值格式错误：" + std::string(e.what()));
+            }
+        }
+        if (const char* redact = std::getenv("STUDENT_SYS_TRACE_REDACT"); redact && *redact) config.redact = true;
+        return config;
+    }
+
+    // 开启跟踪并启动写线程，只能调用一次
+    void enable(Config cfg) {
+        if (writer.joinable()) throw std::runtime_error("SQL跟踪已开启");
+        config = std::move(cfg);
+        if (config.path == "-") {
+            out = &std::clog;
+        } else {
+            file.open(config.path, std::ios::app);
+            if (!file) throw std::runtime_error("SQL跟踪日志打开失败：" + config.path);
+            out = &file;
+        }
+        ring.resize(std::max<std::size_t>(1, config.capacity));
+        writer = std::jthread([this](std::stop_token stop) { drain(stop); });
+        active().store(true, std::memory_order_relaxed);
+    }
+
+    // 执行一条语句并记录：参数在执行前转为文本，异常照常抛出
+    template<typename Fn, typename... Args>
+    static pqxx::result measure(std::string_view name, std::string_view sql, Fn&& fn, const Args&... args) {
+        Record record{.at = std::chrono::system_clock::now(), .name = std::string(name),
+                      .sql = name.empty() ? std::string(sql) : std::string()};
+        record.params.reserve(sizeof...(Args));
+        (record.params.push_back(param(args)), ...);
+        auto start = std::chrono::steady_clock::now();
+        try {
+            pqxx::result res = fn();
+            record.duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+            record.rows = res.columns() > 0 ? res.size() : res.affected_rows();
+            instance().push(std::move(record));
+            return res;
+        } catch (const std::exception& e) {
+            record.duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+            record.error = e.what();
+            instance().push(std::move(record));
+            throw;
+        }
+    }
+};
+
+// 数据库连接池：有界、线程安全，连接按需创建，用完归还复用
+class ConnectionPool {
+public:
+    // 连接池统计信息，用于评估池大小
+    struct Stats {
+        std::size_t capacity = 0;      // 最大连接数
+        std::size_t created = 0;       // 已创建的连接数
+        std::size_t inUse = 0;         // 正在使用的连接数
+        std::size_t idle = 0;          // 空闲连接数
+        std::uint64_t acquires = 0;    // 累计借用次数
+        std::uint64_t waits = 0;       // 需要等待的借用次数
+        double totalWaitMs = 0.0;      // 累计等待时间（毫秒）
+        double maxWaitMs = 0.0;        // 最长单次等待时间（毫秒）
+    };
+
+    // 池中的连接及其已预编译的语句名
+    struct PooledConnection {
+        pqxx::connection conn;
+        std::unordered_set<std::string_view> prepared;
+    };
+
+    // 当前线程绑定的连接（见RequestExecutor）及其上的外层批量事务（见TransactionScope）；
+    // txn为空表示只绑定连接，各操作照常独立开启事务。onCommit为外层事务提交成功后才执行的动作（见TransactionScope::afterCommit）
+    struct Ambient {
+        PooledConnection* conn;
+        pqxx::dbtransaction* txn;
+        std::vector<std::function<void()>>* onCommit;
+    };
+
+    static Ambient*& ambient() {
+        thread_local Ambient* current = nullptr;
+        return current;
+    }
+
+    // 借出的连接：析构时自动归还连接池；线程已绑定连接或处于批量事务中时借用该连接，不归还
+    class Lease {
+    private:
+        ConnectionPool* pool;
+        std::unique_ptr<PooledConnection> owned;
+        PooledConnection* conn;
+        pqxx::dbtransaction* outer = nullptr;
+    public:
+        Lease(ConnectionPool* pool, std::unique_ptr<PooledConnection> conn)
+            : pool(pool), owned(std::move(conn)), conn(owned.get()) {}
+        explicit Lease(const Ambient& ambient)
+            : pool(nullptr), conn(ambient.conn), outer(ambient.txn) {}
+        Lease(Lease&& other) noexcept
+            : pool(std::exchange(other.pool, nullptr)), owned(std::move(other.owned)),
+              conn(other.conn), outer(other.outer) {}
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+        ~Lease() {
+            if (pool && owned) pool->release(std::move(owned));
+        }
+
+        pqxx::connection& operator*() const { return conn->conn; }
+        pqxx::connection* operator->() const { return &conn->conn; }
+
+        // 以给定事务作为本连接上的外层批量事务
+        Ambient bind(pqxx::dbtransaction& txn) const { return Ambient{conn, &txn, nullptr}; }
+
+        // 读写事务（BEGIN计一次往返）；批量事务中改为保存点（SAVEPOINT计一次往返），失败只回滚自身
+        DbTxn write() {
+            ++DBUtil::roundTrips();
+            if (outer) return DbTxn(std::make_unique<pqxx::subtransaction>(*outer));
+            return DbTxn(std::make_unique<pqxx::work>(conn->conn));
+        }
+
+        // 单语句只读查询：自动提交模式，不发送BEGIN/COMMIT，查询本身即唯一一次往返。
+        // 批量事务中改为保存点，查询出错（如输入不合法）只回滚自身，不中止外层事务；
+        // 读取不提交，SAVEPOINT与析构时的ROLLBACK TO SAVEPOINT各计一次往返
+        DbTxn read() {
+            if (outer) {
+                DBUtil::roundTrips() += 2;
+                return DbTxn(std::make_unique<pqxx::subtransaction>(*outer));
+            }
+            return DbTxn(std::make_unique<pqxx::nontransaction>(conn->conn));
+        }
+
+        // 多语句只读报表的快照作用域（BEGIN计一次往返）；批量事务中同样改为保存点（SAVEPOINT计一次往返）
+        DbTxn snapshot() {
+            ++DBUtil::roundTrips();
+            if (outer) return DbTxn(std::make_unique<pqxx::subtransaction>(*outer));
+            return DbTxn(std::make_unique<ReadSnapshot>(conn->conn));
+        }
+
+        // 提交事务（COMMIT/RELEASE SAVEPOINT计一次往返）
+        void commit(DbTxn& txn) {
+            txn->commit();
+            ++DBUtil::roundTrips();
+        }
+
+        // 回滚事务（ROLLBACK计一次往返）
+        void rollback(DbTxn& txn) {
+            txn->abort();
+            ++DBUtil::roundTrips();
+        }
+
+        // 按名称执行已登记的语句：首次在本连接上使用时预编译；开启SQL跟踪时记录每次执行
+        template<typename... Args>
+        pqxx::result exec(pqxx::transaction_base& txn, std::string_view name, Args&&... args) {
+            pqxx::zview stmt = prepare(name);
+            ++DBUtil::roundTrips();
+            pqxx::result res = SqlTrace::enabled()
+                ? SqlTrace::measure(name, {}, [&] { return txn.exec_prepared(stmt, std::forward<Args>(args)...); }, args...)
+                : txn.exec_prepared(stmt, std::forward<Args>(args)...);
+            DBUtil::rowsReturned() += res.size();
+            return res;
+        }
+
+        // 执行未登记的动态SQL（DDL、游标、临时表合并等一次性语句）
+        template<typename... Args>
+        pqxx::result execSql(pqxx::transaction_base& txn, const std::string& sql, Args&&... args) {
+            ++DBUtil::roundTrips();
+            pqxx::result res = SqlTrace::enabled()
+                ? SqlTrace::measure({}, sql, [&] { return txn.exec_params(sql, std::forward<Args>(args)...); }, args...)
+                : txn.exec_params(sql, std::forward<Args>(args)...);
+            DBUtil::rowsReturned() += res.size();
+            return res;
+        }
+
+        // 流式执行已登记的查询：在事务内声明服务端游标，每次FETCH fetchSize行并按批回调
+        void forEachBatch(pqxx::transaction_base& txn, std::string_view name, std::size_t fetchSize,
+                          const std::function<void(const pqxx::result&)>& fn) {
+            fetchSize = std::max<std::size_t>(1, fetchSize);
+            const std::string cursor = std::string(name) + "_cursor";
+            execSql(txn, "DECLARE " + cursor + " NO SCROLL CURSOR FOR " + std::string(SqlRegistry::get(name)));
+            const std::string fetch = "FETCH FORWARD " + std::to_string(fetchSize) + " FROM " + cursor;
+            while (true) {
+                pqxx::result res = execSql(txn, fetch);
+                if (!res.empty()) fn(res);
+                if (static_cast<std::size_t>(res.size()) < fetchSize) break;
+            }
+            execSql(txn, "CLOSE " + cursor);
+        }
+
+        // 确保语句已在本连接上预编译，返回可用于exec_prepared的名称
+        pqxx::zview prepare(std::string_view name) {
+            auto it = conn->prepared.find(name);
+            if (it == conn->prepared.end()) {
+                const auto& [key, sql] = SqlRegistry::entry(name);
+                ++DBUtil::roundTrips();
+                conn->conn.prepare(std::string(key), std::string(sql));
+                it = conn->prepared.insert(key).first;
+            }
+            return pqxx::zview(it->data(), it->size());
+        }
+    };
+
+    explicit ConnectionPool(std::size_t capacity) : capacity(capacity) {}
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // 借用连接：线程已绑定连接（含批量事务）时直接使用；否则优先复用空闲连接，未达上限时新建，再否则等待归还
+    Lease acquire() {
+        if (Ambient* current = ambient()) return Lease(*current);
+        std::unique_lock lock(mtx);
+        ++acquires;
+        auto start = std::chrono::steady_clock::now();
+        bool waited = false;
+        while (idleConns.empty() && created >= capacity) {
+            waited = true;
+            if (!available.wait_until(lock, start + DB_POOL_WAIT_TIMEOUT,
+                                      [this] { return !idleConns.empty() || created < capacity; })) {
+                throw std::runtime_error("获取数据库连接超时：连接池已满（" + std::to_string(capacity) + "）");
+            }
+        }
+        if (waited) {
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            ++waits;
+            totalWaitMs += ms;
+            maxWaitMs = std::max(maxWaitMs, ms);
+        }
+        if (!idleConns.empty()) {
+            auto conn = std::move(idleConns.back());
+            idleConns.pop_back();
+            ++inUse;
+            return Lease(this, std::move(conn));
+        }
+        // 在锁外建立新连接，避免阻塞其他借用者
+        ++created;
+        ++inUse;
+        lock.unlock();
+        try {
+            return Lease(this, std::make_unique<PooledConnection>(PooledConnection{DBUtil::createConn(), {}}));
+        } catch (...) {
+            lock.lock();
+            --created;
+            --inUse;
+            available.notify_one();
+            throw;
+        }
+    }
+
+    Stats stats() const {
+        std::lock_guard lock(mtx);
+        return Stats{capacity, created, inUse, idleConns.size(), acquires, waits, totalWaitMs, maxWaitMs};
+    }
+
+private:
+    // 归还连接：已断开的连接直接丢弃，下次借用时重建
+    void release(std::unique_ptr<PooledConnection> conn) {
+        std::lock_guard lock(mtx);
+        --inUse;
+        if (conn->conn.is_open()) {
+            idleConns.push_back(std::move(conn));
+        } else {
+            --created;
+        }
+        available.notify_one();
+    }
+
+    const std::size_t capacity;
+    mutable std::mutex mtx;
+    std::condition_variable available;
+    std::vector<std::unique_ptr<PooledConnection>> idleConns;
+    std::size_t created = 0;
+    std::size_t inUse = 0;
+    std::uint64_t acquires = 0;
+    std::uint64_t waits = 0;
+    double totalWaitMs = 0.0;
+    double maxWaitMs = 0.0;
+};
+
+inline ConnectionPool& DBUtil::pool() {
+    static ConnectionPool instance(DB_POOL_SIZE);
+    return instance;
+}
+
+// 批量事务作用域：作用域内当前线程的所有仓库操作共用一条连接和一个事务，
+// 每个写操作在各自的保存点中执行（失败只回滚自身），commit()时统一提交；未提交即析构则整体回滚。
+// 依赖数据库提交的内存状态（选课名额等）经afterCommit()登记，整体提交成功后才生效，回滚则丢弃
+class TransactionScope {
+private:
+    ConnectionPool::Ambient* previous;   // 工作线程绑定的连接（无则为空），作用域结束后恢复
+    ConnectionPool::Lease lease;
+    pqxx::work txn;
+    std::vector<std::function<void()>> onCommit;
+    ConnectionPool::Ambient ambient;
+
+    static ConnectionPool::Lease acquireOutermost() {
+        ConnectionPool::Ambient* current = ConnectionPool::ambient();
+        if (current && current->txn) throw std::runtime_error("批量事务不支持嵌套");
+        return DBUtil::pool().acquire();
+    }
+public:
+    TransactionScope()
+        : previous(ConnectionPool::ambient()), lease(acquireOutermost()), txn(*lease), ambient(lease.bind(txn)) {
+        ++DBUtil::roundTrips();
+        ambient.onCommit = &onCommit;
+        ConnectionPool::ambient() = &ambient;
+    }
+    TransactionScope(const TransactionScope&) = delete;
+    TransactionScope& operator=(const TransactionScope&) = delete;
+    ~TransactionScope() {
+        if (ConnectionPool::ambient() == &ambient) ConnectionPool::ambient() = previous;
+    }
+
+    // 提交失败时登记的动作随作用域析构丢弃（持有的选课预占随之归还）
+    void commit() {
+        ConnectionPool::ambient() = previous;
+        txn.commit();
+        ++DBUtil::roundTrips();
+        for (auto& fn : std::exchange(onCommit, {})) fn();
+    }
+
+    // 当前线程处于批量事务中时登记到外层提交之后执行，否则（所在写事务已提交）立即执行
+    static void afterCommit(std::function<void()> fn) {
+        ConnectionPool::Ambient* current = ConnectionPool::ambient();
+        if (current && current->onCommit) {
+            current->onCommit->push_back(std::move(fn));
+        } else {
+            fn();
+        }
+    }
+};
+
+// 并发执行器：固定数量的工作线程，每个线程独占一条数据库连接（不占用全局连接池）及其上的预编译语句。
+// 任务按轮转分发到各线程的队列，空闲线程从其他队列尾部窃取；submit()返回future，任务异常经future抛出
+class RequestExecutor {
+public:
+    struct Stats {
+        std::size_t workers = 0;
+        std::uint64_t submitted = 0;    // 累计提交任务数
+        std::uint64_t completed = 0;    // 累计完成任务数
+        std::uint64_t stolen = 0;       // 被其他线程窃取执行的任务数
+        std::uint64_t roundTrips = 0;   // 各工作线程累计的数据库往返次数
+    };
+
+    explicit RequestExecutor(std::size_t workers) : queues(std::max<std::size_t>(1, workers)) {
+        threads.reserve(queues.size());
+        for (std::size_t i = 0; i < queues.size(); ++i) {
+            threads.emplace_back([this, i] { work(i); });
+        }
+    }
+    RequestExecutor(const RequestExecutor&) = delete;
+    RequestExecutor& operator=(const RequestExecutor&) = delete;
+
+    // 执行完已提交的全部任务后退出
+    ~RequestExecutor() {
+        {
+            std::lock_guard lock(mtx);
+            stopping = true;
+        }
+        ready.notify_all();
+    }
+
+    template<typename Fn>
+    auto submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn&>> {
+        std::packaged_task<std::invoke_result_t<Fn&>()> task(std::forward<Fn>(fn));
+        auto future = task.get_future();
+        std::size_t target = next.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        {
+            std::lock_guard lock(queues[target].mtx);
+            queues[target].tasks.emplace_back(std::move(task));
+        }
+        {
+            std::lock_guard lock(mtx);
+            ++pending;
+            ++submitted;
+        }
+        ready.notify_one();
+        return future;
+    }
+
+    Stats stats() const {
+        std::lock_guard lock(mtx);
+        return Stats{queues.size(), submitted, completed, stolen, roundTrips};
+    }
+
+private:
+    struct Queue {
+        std::mutex mtx;
+        std::deque<std::move_only_function<void()>> tasks;
+    };
+
+    // 先取自己队列的头部，再从其他队列尾部窃取
+    std::optional<std::move_only_function<void()>> take(std::size_t self, bool& wasStolen) {
+        for (std::size_t k = 0; k < queues.size(); ++k) {
+            Queue& q = queues[(self + k) % queues.size()];
+            std::lock_guard lock(q.mtx);
+            if (q.tasks.empty()) continue;
+            wasStolen = k != 0;
+            std::move_only_function<void()> task;
+            if (wasStolen) {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            return task;
+        }
+        return std::nullopt;
+    }
+
+    void work(std::size_t self) {
+        // 连接在首个任务时建立，断开后下一个任务前重建；存储后端不使用数据库时不建立连接
+        std::unique_ptr<ConnectionPool::PooledConnection> conn;
+        ConnectionPool::Ambient bound{nullptr, nullptr, nullptr};
+        while (true) {
+            {
+                std::unique_lock lock(mtx);
+                ready.wait(lock, [this] { return pending > 0 || stopping; });
+                if (pending == 0) return;
+                --pending;
+            }
+            bool wasStolen = false;
+            auto task = take(self, wasStolen);
+            if (!task) continue;   // 不会发生：pending计数与队列中的任务数一致
+            std::uint64_t tripsBefore = DBUtil::roundTrips();
+            try {
+                if (Storage::current().usesDatabase()) {
+                    if (!conn || !conn->conn.is_open()) {
+                        conn = std::make_unique<ConnectionPool::PooledConnection>(
+                            ConnectionPool::PooledConnection{DBUtil::createConn(), {}});
+                        bound.conn = conn.get();
+                    }
+                    ConnectionPool::ambient() = &bound;
+                }
+            } catch (...) {
+                // 建立连接失败时不绑定，任务改从全局连接池借用
+            }
+            (*task)();   // packaged_task内部捕获异常
+            ConnectionPool::ambient() = nullptr;
+            std::lock_guard lock(mtx);
+            ++completed;
+            if (wasStolen) ++stolen;
+            roundTrips += DBUtil::roundTrips() - tripsBefore;
+        }
+    }
+
+    std::vector<Queue> queues;
+    std::atomic<std::size_t> next{0};
+    mutable std::mutex mtx;
+    std::condition_variable ready;
+    std::size_t pending = 0;
+    bool stopping = false;
+    std::uint64_t submitted = 0;
+    std::uint64_t completed = 0;
+    std::uint64_t stolen = 0;
+    std::uint64_t roundTrips = 0;
+    std::vector<std::jthread> threads;   // 最后声明：析构时先等待线程结束，再销毁其使用的成员
+};
+
+// 选课名额分配器：为设置了容量的课程维护内存中的原子计数（已占名额=已选人数+进行中的选课），
+// 课程已满时直接拒绝，不访问数据库；未加载或未设容量的课程不跟踪，照常由数据库判断。
+// 数据库中的条件占座仍是最终保证，内存计数只用于在高峰期挡掉注定失败的请求，并定期与选课表对账
+class SeatAllocator {
+private:
+    struct Seats {
+        std::atomic<int> capacity;
+        std::atomic<int> taken;      // 已占名额（含进行中）
+        std::atomic<int> inflight;   // 已预占、尚未确认或放弃的名额（确认后即不再计入）
+    };
+
+    mutable std::shared_mutex mtx;
+    std::unordered_map<std::string, std::shared_ptr<Seats>> courses;
+    std::jthread reconciler;
+
+    std::shared_ptr<Seats> find(const std::string& courseId) const {
+        std::shared_lock lock(mtx);
+        auto it = courses.find(courseId);
+        return it == courses.end() ? nullptr : it->second;
+    }
+
+public:
+    // 预占的名额：confirm()后计入已选人数（由选课表体现，不再算作进行中）；未确认即析构则归还
+    class Reservation {
+    private:
+        std::shared_ptr<Seats> seats;
+        bool full = false;
+        bool confirmed = false;
+    public:
+        Reservation(std::shared_ptr<Seats> seats, bool full) : seats(std::move(seats)), full(full) {}
+        Reservation(Reservation&& other) noexcept
+            : seats(std::move(other.seats)), full(other.full), confirmed(other.confirmed) {}
+        Reservation(const Reservation&) = delete;
+        Reservation& operator=(const Reservation&) = delete;
+        Reservation& operator=(Reservation&&) = delete;
+        ~Reservation() {
+            if (!seats || confirmed) return;
+            seats->inflight.fetch_sub(1, std::memory_order_relaxed);
+            seats->taken.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        bool rejected() const { return full; }
+
+        // 选课提交后立即调用：此后对账从选课表读到这条记录，不能再按进行中重复计入
+        void confirm() {
+            if (!seats || confirmed) return;
+            confirmed = true;
+            seats->inflight.fetch_sub(1, std::memory_order_relaxed);
+        }
+    };
+
+    struct CourseSeats {
+        std::string courseId;
+        int capacity;
+        int taken;
+    };
+
+    static SeatAllocator& instance() {
+        static SeatAllocator allocator;
+        return allocator;
+    }
+
+    // 预占一个名额：比较并交换，无锁；课程未跟踪时返回空预占（不拒绝）
+    Reservation reserve(const std::string& courseId) {
+        auto seats = find(courseId);
+        if (!seats) return Reservation(nullptr, false);
+        int current = seats->taken.load(std::memory_order_relaxed);
+        do {
+            if (current >= seats->capacity.load(std::memory_order_relaxed)) return Reservation(nullptr, true);
+        } while (!seats->taken.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel,
+                                                     std::memory_order_relaxed));
+        seats->inflight.fetch_add(1, std::memory_order_relaxed);
+        return Reservation(std::move(seats), false);
+    }
+
+    // 退课或删除学生后归还名额
+    void release(const std::string& courseId) {
+        if (auto seats = find(courseId)) seats->taken.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // 课程删除后停止跟踪，之后的选课由数据库返回NoSuchCourse
+    void forget(const std::string& courseId) {
+        std::unique_lock lock(mtx);
+        courses.erase(courseId);
+    }
+
+    // 从数据库加载/对账：已占名额重置为选课表中的人数加上尚未确认的预占（已确认的已在选课表中）；
+    // 提交与confirm()之间的极短窗口内仍可能多计一个名额，下次对账纠正。返回跟踪的课程数
+    std::size_t reconcile() {
+        std::unordered_map<std::string, std::pair<int, int>> loaded;   // 课程ID -> (容量, 已选人数)
+        {
+            auto conn = DBUtil::pool().acquire();
+            auto txn = conn.read();
+            for (const auto& row : conn.exec(txn, "course_seats")) {
+                loaded.emplace(row["id"].as<std::string>(),
+                               std::pair{row["capacity"].as<int>(), row["enrolled"].as<int>()});
+            }
+        }
+        std::unique_lock lock(mtx);
+        std::erase_if(courses, [&](const auto& entry) { return !loaded.contains(entry.first); });
+        for (auto& [id, seat] : loaded) {
+            auto& seats = courses[id];
+            if (!seats) seats = std::make_shared<Seats>(seat.first, 0, 0);
+            seats->capacity.store(seat.first, std::memory_order_relaxed);
+            seats->taken.store(seat.second + seats->inflight.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        return courses.size();
+    }
+
+    // 立即对账一次，之后按interval在后台线程定期对账（对账失败保留原计数，下次重试）
+    void start(std::chrono::seconds interval) {
+        reconcile();
+        reconciler = std::jthread([this, interval](std::stop_token stop) {
+            std::mutex m;
+            std::condition_variable_any cv;
+            while (true) {
+                std::unique_lock lock(m);
+                cv.wait_for(lock, stop, interval, [] { return false; });
+                if (stop.stop_requested()) break;
+                try {
+                    reconcile();
+                } catch (const std::exception& e) {
+                    std::cerr << "选课名额对账失败：" << e.what() << '\n';
+                }
+            }
+        });
+    }
+
+    // 停止后台对账并清空计数，所有课程恢复为仅由数据库判断
+    void stop() {
+        reconciler = std::jthread();
+        std::unique_lock lock(mtx);
+        courses.clear();
+    }
+
+    std::vector<CourseSeats> snapshot() const {
+        std::shared_lock lock(mtx);
+        std::vector<CourseSeats> result;
+        result.reserve(courses.size());
+        for (const auto& [id, seats] : courses) {
+            result.push_back(CourseSeats{id, seats->capacity.load(), seats->taken.load()});
+        }
+        return result;
+    }
+};
+
+// 写合并器（组提交）：开启后，不在批量事务中的成绩录入与选课请求进入队列，由后台线程攒批后在一个事务中提交，
+// 提交开销由整批分摊。最早的请求等满interval或攒够maxOps个时开始一批；每类请求各以一条集合语句
+// （score_set_batch、enrollment_enroll_batch）逐行校验并写入，调用方各自得到自己那一行的结果。
+// 整批语句出错（某一行违反约束、与并发删除冲突等）时改为逐行重试，只有出错的写入得到异常。
+// 调用方阻塞到所在批次提交为止；COMMIT本身出错时不重试（可能已在服务端生效，重试会重复写入），
+// 该批所有调用方得到同一个pqxx::in_doubt_error，须自行核实结果
+class WriteCoalescer {
+public:
+    struct Stats {
+        std::uint64_t batches = 0;     // 已处理的批次数
+        std::uint64_t writes = 0;      // 已处理的写入数
+        std::uint64_t failed = 0;      // 以异常结束的写入数
+        std::uint64_t retried = 0;     // 整批语句出错、改为逐行重试的批次数
+        std::size_t largestBatch = 0;  // 最大批次的写入数
+    };
+
+    static WriteCoalescer& instance() {
+        static WriteCoalescer coalescer;
+        return coalescer;
+    }
+
+    // 从环境变量STUDENT_SYS_GROUP_COMMIT读取“间隔毫秒[,每批上限]”，未设置时不开启
+    static std::optional<std::pair<std::chrono::milliseconds, std::size_t>> configFromEnv() {
+        const char* env = std::getenv("STUDENT_SYS_GROUP_COMMIT");
+        if (!env || !*env) return std::nullopt;
+        std::string_view text(env);
+        auto comma = text.find(',');
+        long ms = GROUP_COMMIT_INTERVAL.count();
+        std::size_t maxOps = GROUP_COMMIT_MAX_OPS;
+        auto number = [](std::string_view part, auto& value) {
+            auto [ptr, ec] = std::from_chars(part.data(), part.data() + part.size(), value);
+            return ec == std::errc() && ptr == part.data() + part.size() && value > 0;
+        };
+        if (!number(text.substr(0, comma), ms) ||
+            (comma != std::string_view::npos && !number(text.substr(comma + 1), maxOps))) {
+            throw std::runtime_error("合并写入参数格式错误（应为“间隔毫秒[,每批上限]”）：" + std::string(text));
+        }
+        return std::pair{std::chrono::milliseconds(ms), maxOps};
+    }
+
+    void start(std::chrono::milliseconds interval = GROUP_COMMIT_INTERVAL, std::size_t maxOps = GROUP_COMMIT_MAX_OPS) {
+        if (flusher.joinable()) throw std::runtime_error("合并写入已开启");
+        this->interval = interval;
+        this->maxOps = std::max<std::size_t>(1, maxOps);
+        flusher = std::jthread([this](std::stop_token stop) { flushLoop(stop); });
+        running.store(true, std::memory_order_release);
+    }
+
+    // 提交队列中剩余的写入后停止，之后的写入恢复为各自独立提交
+    void stop() {
+        running.store(false, std::memory_order_release);
+        flusher = std::jthread();
+        // 刷写线程退出前已通过accepts()检查的写入可能刚入队，这里补交
+        std::unique_lock lock(mtx);
+        auto scoreBatch = std::exchange(scores, {});
+        auto enrollBatch = std::exchange(enrolls, {});
+        lock.unlock();
+        if (!scoreBatch.empty() || !enrollBatch.empty()) flush(scoreBatch, enrollBatch);
+    }
+
+    // 当前线程的写入是否应进入队列：已开启且不在批量事务中（批量事务自有提交时机）
+    bool accepts() const {
+        if (!running.load(std::memory_order_acquire)) return false;
+        auto* ambient = ConnectionPool::ambient();
+        return !(ambient && ambient->txn);
+    }
+
+    ScoreResult setScore(const Score& score) {
+        std::future<ScoreResult> result;
+        {
+            std::lock_guard lock(mtx);
+            auto& write = scores.emplace_back(ScoreWrite{score, {}});
+            result = write.result.get_future();
+            enqueued();
+        }
+        ready.notify_one();
+        return result.get();
+    }
+
+    EnrollResult enroll(const std::string& studentId, const std::string& courseId) {
+        std::future<EnrollResult> result;
+        {
+            std::lock_guard lock(mtx);
+            auto& write = enrolls.emplace_back(EnrollWrite{studentId, courseId, {}});
+            result = write.result.get_future();
+            enqueued();
+        }
+        ready.notify_one();
+        return result.get();
+    }
+
+    Stats stats() const {
+        std::lock_guard lock(mtx);
+        return totals;
+    }
+
+private:
+    struct ScoreWrite {
+        Score score;
+        std::promise<ScoreResult> result;
+    };
+    struct EnrollWrite {
+        std::string studentId;
+        std::string courseId;
+        std::promise<EnrollResult> result;
+    };
+
+    std::chrono::milliseconds interval = GROUP_COMMIT_INTERVAL;
+    std::size_t maxOps = GROUP_COMMIT_MAX_OPS;
+    std::atomic<bool> running{false};
+    mutable std::mutex mtx;
+    std::condition_variable_any ready;
+    std::vector<ScoreWrite> scores;
+    std::vector<EnrollWrite> enrolls;
+    std::chrono::steady_clock::time_point oldest;   // 队列中最早请求的到达时间
+    Stats totals;
+    std::unique_ptr<ConnectionPool::PooledConnection> conn;   // 刷写线程独占的连接
+    std::jthread flusher;                                      // 最后声明：析构时先提交剩余写入
+
+    std::size_t queued() const { return scores.size() + enrolls.size(); }
+
+    void enqueued() {
+        if (queued() == 1) oldest = std::chrono::steady_clock::now();
+    }
+
+    void flushLoop(std::stop_token stop) {
+        std::unique_lock lock(mtx);
+        while (true) {
+            ready.wait(lock, stop, [this] { return queued() > 0; });
+            if (queued() == 0) return;
+            ready.wait_until(lock, stop, oldest + interval, [this] { return queued() >= maxOps; });
+            auto scoreBatch = std::exchange(scores, {});
+            auto enrollBatch = std::exchange(enrolls, {});
+            lock.unlock();
+            Flushed flushed = flush(scoreBatch, enrollBatch);
+            lock.lock();
+            std::size_t size = scoreBatch.size() + enrollBatch.size();
+            ++totals.batches;
+            totals.writes += size;
+            totals.failed += flushed.failed;
+            if (flushed.retried) ++totals.retried;
+            totals.largestBatch = std::max(totals.largestBatch, size);
+        }
+    }
+
+    struct Flushed {
+        std::size_t failed = 0;   // 以异常结束的写入数
+        bool retried = false;     // 是否改为逐行重试
+    };
+
+    template<typename T>
+    using Outcome = std::variant<T, std::exception_ptr>;
+
+    template<typename Fn>
+    static auto attempt(Fn&& fn) -> Outcome<decltype(fn())> {
+        try {
+            return fn();
+        } catch (...) {
+            return std::current_exception();
+        }
+    }
+
+    // 刷写线程独占的连接：首次使用或断开后重新建立
+    ConnectionPool::PooledConnection* connection() {
+        if (!conn || !conn->conn.is_open()) {
+            conn = std::make_unique<ConnectionPool::PooledConnection>(
+                ConnectionPool::PooledConnection{DBUtil::createConn(), {}});
+        }
+        return conn.get();
+    }
+
+    // 整批以同一个异常结束
+    static Flushed failAll(std::vector<ScoreWrite>& scoreBatch, std::vector<EnrollWrite>& enrollBatch,
+                           std::exception_ptr error, bool retried) {
+        for (auto& write : scoreBatch) write.result.set_exception(error);
+        for (auto& write : enrollBatch) write.result.set_exception(error);
+        return Flushed{scoreBatch.size() + enrollBatch.size(), retried};
+    }
+
+    // 在catch中调用：COMMIT已发出后出错，事务可能已生效也可能已回滚，统一以in_doubt_error交给调用方
+    static std::exception_ptr inDoubt() {
+        try {
+            throw;
+        } catch (const pqxx::in_doubt_error&) {
+            return std::current_exception();
+        } catch (const std::exception& e) {
+            return std::make_exception_ptr(pqxx::in_doubt_error("合并写入提交结果未知：" + std::string(e.what())));
+        }
+    }
+
+    // 在一个事务中执行整批写入，提交成功后才交付各调用方的结果；
+    // COMMIT之前出错（整批语句违反约束等）时改为逐行重试，COMMIT出错时不重试
+    Flushed flush(std::vector<ScoreWrite>& scoreBatch, std::vector<EnrollWrite>& enrollBatch) {
+        std::vector<ScoreResult> scoreResults;
+        std::vector<EnrollResult> enrollResults;
+        bool committing = false;
+        try {
+            ConnectionPool::Lease lease(ConnectionPool::Ambient{connection(), nullptr, nullptr});
+            auto txn = lease.write();
+            if (!scoreBatch.empty()) scoreResults = writeScores(lease, txn, scoreBatch);
+            if (!enrollBatch.empty()) enrollResults = writeEnrollments(lease, txn, enrollBatch);
+            committing = true;
+            lease.commit(txn);
+        } catch (...) {
+            if (committing) return failAll(scoreBatch, enrollBatch, inDoubt(), false);
+            return retryRows(scoreBatch, enrollBatch);
+        }
+        for (std::size_t i = 0; i < scoreBatch.size(); ++i) scoreBatch[i].result.set_value(scoreResults[i]);
+        for (std::size_t i = 0; i < enrollBatch.size(); ++i) enrollBatch[i].result.set_value(enrollResults[i]);
+        return Flushed{};
+    }
+
+    // 逐行重试：仍在一个事务中，每个写入以单条语句（score_set、enrollment_enroll）在各自的保存点中执行，
+    // 出错的写入只回滚自身并得到自己的异常，其余写入照常提交；提交出错时同样不再重试
+    Flushed retryRows(std::vector<ScoreWrite>& scoreBatch, std::vector<EnrollWrite>& enrollBatch) {
+        Flushed flushed{0, true};
+        std::vector<Outcome<ScoreResult>> scoreOutcomes;
+        std::vector<Outcome<EnrollResult>> enrollOutcomes;
+        bool committing = false;
+        try {
+            ConnectionPool::PooledConnection* c = connection();
+            pqxx::work txn(c->conn);
+            ++DBUtil::roundTrips();
+            ConnectionPool::Lease lease(ConnectionPool::Ambient{c, &txn, nullptr});
+            for (const auto& write : scoreBatch) {
+                scoreOutcomes.push_back(attempt([&] {
+                    const Score& score = write.score;
+                    auto savepoint = lease.write();
+                    pqxx::row row = lease.exec(savepoint, "score_set", score.getStudentId(), score.getCourseId(),
+                                               score.getScore())[0];
+                    lease.commit(savepoint);
+                    return scoreResult(row);
+                }));
+            }
+            for (const auto& write : enrollBatch) {
+                enrollOutcomes.push_back(attempt([&] {
+                    auto savepoint = lease.write();
+                    pqxx::row row = lease.exec(savepoint, "enrollment_enroll", write.studentId, write.courseId)[0];
+                    if (row["inserted"].as<bool>()) lease.commit(savepoint);
+                    else lease.rollback(savepoint);   // 撤销可能已占的名额
+                    return enrollResult(row);
+                }));
+            }
+            committing = true;
+            txn.commit();
+            ++DBUtil::roundTrips();
+        } catch (...) {
+            return failAll(scoreBatch, enrollBatch, committing ? inDoubt() : std::current_exception(), true);
+        }
+        auto deliver = [&](auto& batch, auto& outcomes) {
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                if (auto* error = std::get_if<std::exception_ptr>(&outcomes[i])) {
+                    batch[i].result.set_exception(*error);
+                    ++flushed.failed;
+                } else {
+                    batch[i].result.set_value(std::get<0>(outcomes[i]));
+                }
+            }
+        };
+        deliver(scoreBatch, scoreOutcomes);
+        deliver(enrollBatch, enrollOutcomes);
+        return flushed;
+    }
+
+    // 单条与批量语句返回的校验列相同
+    static ScoreResult scoreResult(const pqxx::row& row) {
+        if (!row["student_ok"].as<bool>()) return ScoreResult::NoSuchStudent;
+        if (!row["course_ok"].as<bool>()) return ScoreResult::NoSuchCourse;
+        if (!row["enrolled"].as<bool>()) return ScoreResult::NotEnrolled;
+        return ScoreResult::Ok;
+    }
+
+    // 结果判定与单条选课一致：占了名额但插入冲突视为已选
+    static EnrollResult enrollResult(const pqxx::row& row) {
+        if (!row["student_ok"].as<bool>()) return EnrollResult::NoSuchStudent;
+        if (!row["course_ok"].as<bool>()) return EnrollResult::NoSuchCourse;
+        if (row["duplicate"].as<bool>()) return EnrollResult::AlreadyEnrolled;
+        if (row["inserted"].as<bool>()) return EnrollResult::Ok;
+        if (row["seated"].as<bool>()) return EnrollResult::AlreadyEnrolled;
+        return EnrollResult::CourseFull;
+    }
+
+    static std::vector<ScoreResult> writeScores(ConnectionPool::Lease& lease, DbTxn& txn,
+                                                const std::vector<ScoreWrite>& batch) {
+        std::vector<std::string> studentIds, courseIds;
+        std::vector<double> values;
+        for (const auto& write : batch) {
+            studentIds.push_back(write.score.getStudentId());
+            courseIds.push_back(write.score.getCourseId());
+            values.push_back(write.score.getScore());
+        }
+        pqxx::result res = lease.exec(txn, "score_set_batch", studentIds, courseIds, values);
+        std::vector<ScoreResult> results(batch.size(), ScoreResult::Ok);
+        for (const auto& row : res) results.at(row["ord"].as<std::size_t>() - 1) = scoreResult(row);
+        return results;
+    }
+
+    static std::vector<EnrollResult> writeEnrollments(ConnectionPool::Lease& lease, DbTxn& txn,
+                                                      const std::vector<EnrollWrite>& batch) {
+        std::vector<std::string> studentIds, courseIds;
+        for (const auto& write : batch) {
+            studentIds.push_back(write.studentId);
+            courseIds.push_back(write.courseId);
+        }
+        pqxx::result res = lease.exec(txn, "enrollment_enroll_batch", studentIds, courseIds);
+        std::vector<EnrollResult> results(batch.size(), EnrollResult::Ok);
+        for (const auto& row : res) results.at(row["ord"].as<std::size_t>() - 1) = enrollResult(row);
+        return results;
+    }
+};
+
+// 延迟直方图：HDR风格的对数-线性分桶（每个2的幂区间再分8档，相对误差约12%），
+// 桶计数为原子变量，记录无锁
+class LatencyHistogram {
+public:
+    static constexpr std::size_t SUB_BITS = 4;
+    static constexpr std::size_t HALF = std::size_t{1} << (SUB_BITS - 1);
+    static constexpr std::size_t BUCKETS = (64 - SUB_BITS + 2) * HALF;
+
+    static std::size_t bucketOf(std::uint64_t ns) {
+        if (ns < 2 * HALF) return static_cast<std::size_t>(ns);
+        std::size_t shift = std::bit_width(ns) - SUB_BITS;
+        return (shift + 1) * HALF + static_cast<std::size_t>((ns >> shift) - HALF);
+    }
+
+    // 桶的上界（纳秒）
+    static std::uint64_t upperBound(std::size_t bucket) {
+        if (bucket < 2 * HALF) return bucket;
+        std::size_t shift = bucket / HALF - 1;
+        std::uint64_t mantissa = bucket % HALF + HALF;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    void record(std::uint64_t ns) {
+        counts[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 分位数p（0~1）所在桶的上界（纳秒）
+    std::uint64_t percentile(double p) const {
+        std::array<std::uint64_t, BUCKETS> snapshot;
+        std::uint64_t total = 0;
+        for (std::size_t i = 0; i < BUCKETS; ++i) total += snapshot[i] = counts[i].load(std::memory_order_relaxed);
+        if (total == 0) return 0;
+        auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(p * total)));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BUCKETS; ++i) {
+            seen += snapshot[i];
+            if (seen >= rank) return upperBound(i);
+        }
+        return upperBound(BUCKETS - 1);
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, BUCKETS> counts{};
+};
+
+// 单个操作（仓库方法或控制器动作）的累计指标
+struct OperationMetrics {
+    std::string name;
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> errors{0};
+    std::atomic<std::uint64_t> roundTrips{0};
+    std::atomic<std::uint64_t> rows{0};
+    std::atomic<std::uint64_t> totalNs{0};
+    std::atomic<std::uint64_t> maxNs{0};
+    LatencyHistogram latency;
+
+    explicit OperationMetrics(std::string name) : name(std::move(name)) {}
+};
+
+// 指标注册表：操作首次被调用时登记（加锁一次），之后各线程经线程局部缓存直接取得指标对象
+class Metrics {
+private:
+    std::mutex mtx;
+    std::deque<OperationMetrics> operations;   // deque保证元素地址稳定
+    std::unordered_map<std::string, OperationMetrics*> byName;
+    std::jthread watcher;
+
+    static std::atomic<bool>& dumpRequested() {
+        static std::atomic<bool> flag{false};
+        return flag;
+    }
+
+    // 从source_location的函数签名中取出“类名::方法名”
+    static std::string operationName(std::string_view signature) {
+        signature = signature.substr(0, signature.find('('));
+        auto space = signature.rfind(' ');
+        return std::string(space == std::string_view::npos ? signature : signature.substr(space + 1));
+    }
+
+public:
+    static Metrics& instance() {
+        static Metrics metrics;
+        return metrics;
+    }
+
+    // 按函数取指标对象：以函数名字符串的地址为键做线程局部缓存
+    OperationMetrics& of(const std::source_location& where) {
+        thread_local std::unordered_map<const char*, OperationMetrics*> cache;
+        auto& slot = cache[where.function_name()];
+        if (!slot) {
+            std::string name = operationName(where.function_name());
+            std::lock_guard lock(mtx);
+            auto& entry = byName[name];
+            if (!entry) entry = &operations.emplace_back(name);
+            slot = entry;
+        }
+        return *slot;
+    }
+
+    // 按名称排序输出汇总（延迟单位：微秒）
+    void report(std::ostream& out) {
+        std::vector<const OperationMetrics*> sorted;
+        {
+            std::lock_guard lock(mtx);
+            for (const auto& op : operations) sorted.push_back(&op);
+        }
+        std::ranges::sort(sorted, {}, &OperationMetrics::name);
+        std::string text = "\n=== 操作指标 ===\n" +
+                           std::format("{:<44}{:>9}{:>7}{:>9}{:>9}{:>10}{:>10}{:>10}{:>10}{:>10}{:>10}\n", "操作", "调用",
+                                       "失败", "往返/次", "行/次", "均值us", "p50us", "p90us", "p99us", "p999us", "最大us");
+        for (const auto* op : sorted) {
+            std::uint64_t calls = op->calls.load(std::memory_order_relaxed);
+            if (calls == 0) continue;
+            double n = static_cast<double>(calls);
+            text += std::format("{:<44}{:>9}{:>7}{:>9.2f}{:>9.1f}{:>10.1f}{:>10.1f}{:>10.1f}{:>10.1f}{:>10.1f}{:>10.1f}\n",
+                                op->name, calls, op->errors.load(), op->roundTrips.load() / n, op->rows.load() / n,
+                                op->totalNs.load() / n / 1000, op->latency.percentile(0.50) / 1000.0,
+                                op->latency.percentile(0.90) / 1000.0, op->latency.percentile(0.99) / 1000.0,
+                                op->latency.percentile(0.999) / 1000.0, op->maxNs.load() / 1000.0);
+        }
+        out << text << std::flush;
+    }
+
+    // 启用汇总输出：进程正常退出时输出一次；收到SIGUSR1时由后台线程输出当前汇总（信号处理函数只置标志）
+    void enableReporting() {
+        std::atexit([] { Metrics::instance().report(std::clog); });
+        std::signal(SIGUSR1, [](int) { dumpRequested().store(true, std::memory_order_relaxed); });
+        watcher = std::jthread([this](std::stop_token stop) {
+            while (!stop.stop_requested()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                if (dumpRequested().exchange(false, std::memory_order_relaxed)) report(std::clog);
+            }
+        });
+    }
+};
+
+// 操作计时：在仓库方法/控制器动作开头构造，析构时记录耗时、往返次数、返回行数；
+// 因异常离开或调用fail()计为失败
+class OperationTimer {
+private:
+    OperationMetrics& metrics;
+    std::chrono::steady_clock::time_point start;
+    std::uint64_t tripsBefore;
+    std::uint64_t rowsBefore;
+    int exceptionsBefore;
+    bool failed = false;
+public:
+    explicit OperationTimer(std::source_location where = std::source_location::current())
+        : metrics(Metrics::instance().of(where)), start(std::chrono::steady_clock::now()),
+          tripsBefore(DBUtil::roundTrips()), rowsBefore(DBUtil::rowsReturned()),
+          exceptionsBefore(std::uncaught_exceptions()) {}
+    OperationTimer(const OperationTimer&) = delete;
+    OperationTimer& operator=(const OperationTimer&) = delete;
+
+    // 未抛异常的失败（如业务校验不通过、控制器返回false）
+    void fail() { failed = true; }
+
+    ~OperationTimer() {
+        auto ns = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        metrics.calls.fetch_add(1, std::memory_order_relaxed);
+        if (failed || std::uncaught_exceptions() > exceptionsBefore) metrics.errors.fetch_add(1, std::memory_order_relaxed);
+        metrics.roundTrips.fetch_add(DBUtil::roundTrips() - tripsBefore, std::memory_order_relaxed);
+        metrics.rows.fetch_add(DBUtil::rowsReturned() - rowsBefore, std::memory_order_relaxed);
+        metrics.totalNs.fetch_add(ns, std::memory_order_relaxed);
+        std::uint64_t max = metrics.maxNs.load(std::memory_order_relaxed);
+        while (ns > max && !metrics.maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+        metrics.latency.record(ns);
+    }
+};
+
+// 输入处理工具：处理cin异常，避免死循环
+class InputUtil {
+public:
+    // 清空输入缓冲区
+    static void clearInput() {
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+
+    // 读取整数（带范围校验）
+    static int readInt(int min, int max) {
+        int num;
+        while (true) {
+            if (std::cin >> num && num >= min && num <= max) {
+                clearInput();
+                return num;
+            } else {
+                clearInput();
+                std::cout << "输入无效，请输入" << min << "-" << max << "之间的整数：";
+            }
+        }
+    }
+
+    // 读取字符串（非空校验）
+    static std::string readString(const std::string& tip) {
+        std::string str;
+        while (true) {
+            std::cout << tip;
+            std::cin >> str;
+            if (!str.empty()) {
+                return str;
+            }
+            std::cout << "输入不能为空！" << std::endl;
+        }
+    }
+
+    // 读取浮点数（0-100范围，成绩专用）
+    static double readScore() {
+        double s;
+        while (true) {
+            std::cout << "输入成绩（0-100）：";
+            if (std::cin >> s && s >= 0 && s <= 100) {
+                clearInput();
+                return s;
+            } else {
+                clearInput();
+                std::cout << "成绩无效，请输入0-100的数字！" << std::endl;
+            }
+        }
+    }
+};
+
+// 表格渲染工具：按终端显示宽度（中日韩字符占2列）对齐各列，行内容用std::format写入可复用的缓冲区，
+// 累计到一定大小后整块写出，避免逐行刷新和流操纵符的格式化开销
+class TableRenderer {
+public:
+    explicit TableRenderer(std::vector<std::string> titles, std::ostream& out = std::cout,
+                           std::size_t columnWidth = TABLE_WIDTH)
+        : out(out), titles(std::move(titles)), widths(this->titles.size(), columnWidth) {
+        for (std::size_t i = 0; i < this->titles.size(); ++i) {
+            widths[i] = std::max(widths[i], displayWidth(this->titles[i]) + 1);
+        }
+        buffer.reserve(FLUSH_THRESHOLD + 4096);
+    }
+    TableRenderer(const TableRenderer&) = delete;
+    TableRenderer& operator=(const TableRenderer&) = delete;
+    ~TableRenderer() {
+        try {
+            flush();
+        } catch (...) {
+        }
+    }
+
+    // 标题行及其下方的分隔线
+    void header() {
+        for (std::size_t i = 0; i < titles.size(); ++i) cell(i, titles[i]);
+        buffer += '\n';
+        separator();
+    }
+
+    void separator() {
+        std::size_t total = 0;
+        for (auto w : widths) total += w;
+        buffer.append(total, '-');
+        buffer += '\n';
+    }
+
+    // 一行数据：浮点数保留1位小数，其余类型按std::format默认格式
+    template<typename... Cells>
+    void row(const Cells&... cells) {
+        std::size_t column = 0;
+        (cell(column++, cells), ...);
+        buffer += '\n';
+        if (buffer.size() >= FLUSH_THRESHOLD) flush();
+    }
+
+    // 表格之外的一行文本（标题、汇总等）
+    void line(std::string_view text) {
+        buffer += text;
+        buffer += '\n';
+    }
+
+    void flush() {
+        if (buffer.empty()) return;
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+
+    // UTF-8文本的终端显示宽度：东亚宽字符计2列，其余计1列
+    static std::size_t displayWidth(std::string_view text) {
+        std::size_t width = 0;
+        for (std::size_t i = 0; i < text.size();) {
+            auto lead = static_cast<unsigned char>(text[i]);
+            std::size_t len = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 1;
+            if (len == 1 || i + len > text.size()) {
+                ++width;
+                ++i;
+                continue;
+            }
+            char32_t cp = lead & (0x7F >> len);
+            for (std::size_t k = 1; k < len; ++k) cp = (cp << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3F);
+            width += isWide(cp) ? 2 : 1;
+            i += len;
+        }
+        return width;
+    }
+
+private:
+    static constexpr std::size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    std::ostream& out;
+    std::vector<std::string> titles;
+    std::vector<std::size_t> widths;
+    std::string buffer;
+
+    static bool isWide(char32_t cp) {
+        return (cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0xA4CF) ||
+               (cp >= 0xAC00 && cp <= 0xD7A3) || (cp >= 0xF900 && cp <= 0xFAFF) ||
+               (cp >= 0xFE30 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF60) ||
+               (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x20000 && cp <= 0x3FFFD);
+    }
+
+    // 写入一个单元格并按显示宽度补齐空格；超宽内容至少保留一个空格分隔
+    template<typename T>
+    void cell(std::size_t column, const T& value) {
+        std::size_t start = buffer.size();
+        if constexpr (std::is_floating_point_v<T>) {
+            std::format_to(std::back_inserter(buffer), "{:.1f}", value);
+        } else {
+            std::format_to(std::back_inserter(buffer), "{}", value);
+        }
+        std::size_t used = displayWidth(std::string_view(buffer).substr(start));
+        std::size_t width = column < widths.size() ? widths[column] : TABLE_WIDTH;
+        buffer.append(used < width ? width - used : 1, ' ');
+    }
+};
+
+// CSV工具：逐行解析，支持双引号包裹的字段及""转义（字段内不含换行）
+class CsvUtil {
+public:
+    static std::vector<std::string> splitLine(std::string_view line) {
+        std::vector<std::string> fields(1);
+        bool quoted = false;
+        for (std::size_t i = 0; i < line.size(); ++i) {
+            char ch = line[i];
+            if (quoted) {
+                if (ch == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                    fields.back() += '"';
+                    ++i;
+                } else if (ch == '"') {
+                    quoted = false;
+                } else {
+                    fields.back() += ch;
+                }
+            } else if (ch == '"') {
+                quoted = true;
+            } else if (ch == ',') {
+                fields.emplace_back();
+            } else if (ch != '\r') {
+                fields.back() += ch;
+            }
+        }
+        return fields;
+    }
+
+    // 读取一行，去掉UTF-8 BOM（Excel导出的CSV常带BOM）
+    static bool readLine(std::istream& in, std::string& line, bool first) {
+        if (!std::getline(in, line)) return false;
+        if (first && line.starts_with("\xEF\xBB\xBF")) line.erase(0, 3);
+        return true;
+    }
+};
+
+// ====================== 数据管理层（仓库层）======================
+// 行解码器：每个结果集只按列名解析一次列下标，逐行按下标读取；字符串字段从视图直接构造，每个字段一次分配
+class StudentDecoder {
+private:
+    pqxx::row::size_type id, name, major;
+public:
+    explicit StudentDecoder(const pqxx::result& res)
+        : id(res.column_number("id")), name(res.column_number("name")), major(res.column_number("major")) {}
+
+    Student operator()(const pqxx::row& row) const {
+        return Student(std::string(row[id].view()), std::string(row[name].view()), std::string(row[major].view()));
+    }
+};
+
+class TeacherDecoder {
+private:
+    pqxx::row::size_type id, name, department;
+public:
+    explicit TeacherDecoder(const pqxx::result& res)
+        : id(res.column_number("id")), name(res.column_number("name")), department(res.column_number("department")) {}
+
+    Teacher operator()(const pqxx::row& row) const {
+        return Teacher(std::string(row[id].view()), std::string(row[name].view()), std::string(row[department].view()));
+    }
+};
+
+class CourseDecoder {
+private:
+    pqxx::row::size_type id, name, credit, teacherId;
+public:
+    explicit CourseDecoder(const pqxx::result& res)
+        : id(res.column_number("id")), name(res.column_number("name")),
+          credit(res.column_number("credit")), teacherId(res.column_number("teacher_id")) {}
+
+    Course operator()(const pqxx::row& row) const {
+        return Course(std::string(row[id].view()), std::string(row[name].view()),
+                      row[credit].as<int>(), std::string(row[teacherId].view()));
+    }
+};
+
+class ScoreDecoder {
+private:
+    pqxx::row::size_type studentId, courseId, score;
+public:
+    explicit ScoreDecoder(const pqxx::result& res)
+        : studentId(res.column_number("student_id")), courseId(res.column_number("course_id")),
+          score(res.column_number("score")) {}
+
+    Score operator()(const pqxx::row& row) const {
+        return Score(std::string(row[studentId].view()), std::string(row[courseId].view()), row[score].as<double>());
+    }
+};
+
+class TranscriptEntryDecoder {
+private:
+    pqxx::row::size_type courseId, courseName, credit, score;
+public:
+    explicit TranscriptEntryDecoder(const pqxx::result& res)
+        : courseId(res.column_number("course_id")), courseName(res.column_number("course_name")),
+          credit(res.column_number("credit")), score(res.column_number("score")) {}
+
+    TranscriptEntry operator()(const pqxx::row& row) const {
+        return TranscriptEntry(std::string(row[courseId].view()), std::string(row[courseName].view()),
+                               row[credit].as<int>(), row[score].as<double>());
+    }
+};
+
+// PostgreSQL存储后端：经全局连接池执行SqlRegistry中登记的语句；线程处于批量事务中时随外层事务提交
+class PostgresStorage : public Storage {
+public:
+    PostgresStorage() { verifySchema(); }
+
+    // 表结构检查：选课与删除语句读写courses.capacity/enrolled，缺少时提示执行迁移脚本，而不是等到选课时报“列不存在”。
+    // 使用独立连接，不占用连接池（基准程序在首次借用连接前才切换schema）
+    static void verifySchema() {
+        try {
+            pqxx::connection conn = DBUtil::createConn();
+            pqxx::nontransaction txn(conn);
+            pqxx::field missing = txn.exec(
+                "SELECT string_agg(c.name, ', ') FROM (VALUES ('capacity'), ('enrolled')) c(name) "
+                "WHERE NOT EXISTS (SELECT 1 FROM information_schema.columns WHERE table_schema = current_schema() "
+                "AND table_name = 'courses' AND column_name = c.name)")[0][0];
+            if (!missing.is_null()) {
+                throw std::runtime_error("表courses缺少列" + missing.as<std::string>() +
+                                         "，请先执行迁移脚本20/migrations/001_course_capacity.sql");
+            }
+        } catch (const std::exception& e) {
+            throw std::runtime_error("数据库表结构检查失败：" + std::string(e.what()));
+        }
+    }
+
+    std::string_view name() const override { return "postgres"; }
+    bool usesDatabase() const override { return true; }
+
+    void insertStudent(const Student& student) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.write();
+        conn.exec(txn, "student_insert", student.getId(), student.getName(), student.getMajor());
+        conn.commit(txn);
+    }
+
+    std::optional<Student> findStudent(const std::string& id) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.read();
+        pqxx::result res = conn.exec(txn, "student_get_by_id", id);
+        if (res.empty()) return std::nullopt;
+        return StudentDecoder(res)(res[0]);
+    }
+
+    std::vector<Student> listStudents() override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.read();
+        pqxx::result res = conn.exec(txn, "student_list");
+        std::vector<Student> students;
+        students.reserve(res.size());
+        StudentDecoder decode(res);
+        for (const auto& row : res) students.push_back(decode(row));
+        return students;
+    }
+
+    // 按ID顺序分批拉取，内存占用与表大小无关
+    void forEachStudent(const std::function<void(const Student&)>& fn, std::size_t fetchSize) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.snapshot();
+        conn.forEachBatch(txn, "student_list", fetchSize, [&](const pqxx::result& batch) {
+            StudentDecoder decode(batch);
+            for (const auto& row : batch) fn(decode(row));
+        });
+        conn.commit(txn);
+    }
+
+    // 成绩、选课、学生在一条语句中删除；提交后归还所退课程在SeatAllocator中的名额
+    std::optional<CascadeDeleteResult> deleteStudent(const std::string& id) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.write();
+        pqxx::result res = conn.exec(txn, "student_delete_cascade", id);
+        pqxx::row row = res[0];
+        if (row["deleted"].as<int>() == 0) return std::nullopt;
+        conn.commit(txn);
+        for (const auto& r : res) {
+            if (r["course_id"].is_null()) continue;
+            TransactionScope::afterCommit([courseId = r["course_id"].as<std::string>()] {
+                SeatAllocator::instance().release(courseId);
+            });
+        }
+        return CascadeDeleteResult{row["scores"].as<std::size_t>(), row["enrollments"].as<std::size_t>()};
+    }
+
+    void insertTeacher(const Teacher& teacher) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.write();
+        conn.exec(txn, "teacher_insert", teacher.getId(), teacher.getName(), teacher.getDepartment());
+        conn.commit(txn);
+    }
+
+    std::optional<Teacher> findTeacher(const std::string& id) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.read();
+        pqxx::result res = conn.exec(txn, "teacher_get_by_id", id);
+        if (res.empty()) return std::nullopt;
+        return TeacherDecoder(res)(res[0]);
+    }
+
+    void insertCourse(const Course& course) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.write();
+        conn.exec(txn, "course_insert", course.getId(), course.getName(), course.getCredit(), course.getTeacherId());
+        conn.commit(txn);
+    }
+
+    std::optional<Course> findCourse(const std::string& id) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.read();
+        pqxx::result res = conn.exec(txn, "course_get_by_id", id);
+        if (res.empty()) return std::nullopt;
+        return CourseDecoder(res)(res[0]);
+    }
+
+    // 一次查询返回所有存在的课程
+    std::vector<Course> findCourses(std::span<const std::string> ids) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.read();
+        pqxx::result res = conn.exec(txn, "course_get_by_ids", std::vector<std::string>(ids.begin(), ids.end()));
+        std::vector<Course> courses;
+        courses.reserve(res.size());
+        CourseDecoder decode(res);
+        for (const auto& row : res) courses.push_back(decode(row));
+        return courses;
+    }
+
+    std::vector<Course> listCourses() override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.read();
+        pqxx::result res = conn.exec(txn, "course_list");
+        std::vector<Course> courses;
+        courses.reserve(res.size());
+        CourseDecoder decode(res);
+        for (const auto& row : res) courses.push_back(decode(row));
+        return courses;
+    }
+
+    // 按ID顺序分批拉取，内存占用与表大小无关
+    void forEachCourse(const std::function<void(const Course&)>& fn, std::size_t fetchSize) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.snapshot();
+        conn.forEachBatch(txn, "course_list", fetchSize, [&](const pqxx::result& batch) {
+            CourseDecoder decode(batch);
+            for (const auto& row : batch) fn(decode(row));
+        });
+        conn.commit(txn);
+    }
+
+    bool setCapacity(const std::string& id, std::optional<int> capacity) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.write();
+        if (conn.exec(txn, "course_set_capacity", id, capacity).affected_rows() == 0) return false;
+        conn.commit(txn);
+        return true;
+    }
+
+    // chunkSize为0时一条语句完成；否则先按每批chunkSize个学生分多个短事务删除选课/成绩，
+    // 最后再删除课程及剩余记录，避免大课程长时间持锁阻塞并发选课
+    std::optional<CascadeDeleteResult> deleteCourse(const std::string& id, std::size_t chunkSize) override {
+        if (chunkSize > 0 && !findCourse(id)) return std::nullopt;
+        CascadeDeleteResult result{0, 0, 0};
+        auto conn = DBUtil::pool().acquire();
+        for (std::size_t deleted = chunkSize; chunkSize > 0 && deleted >= chunkSize;) {
+            auto txn = conn.write();
+            pqxx::row row = conn.exec(txn, "course_delete_chunk", id, chunkSize)[0];
+            conn.commit(txn);
+            deleted = row["enrollments"].as<std::size_t>();
+            result.enrollments += deleted;
+            result.scores += row["scores"].as<std::size_t>();
+            ++result.batches;
+        }
+        auto txn = conn.write();
+        pqxx::row row = conn.exec(txn, "course_delete_cascade", id)[0];
+        if (row["deleted"].as<int>() == 0) return std::nullopt;
+        conn.commit(txn);
+        TransactionScope::afterCommit([id] { SeatAllocator::instance().forget(id); });
+        result.enrollments += row["enrollments"].as<std::size_t>();
+        result.scores += row["scores"].as<std::size_t>();
+        ++result.batches;
+        return result;
+    }
+
+    // 选课校验与upsert由一条语句完成；开启合并写入时与其他调用方的录入一起提交
+    ScoreResult setScore(const Score& score) override {
+        if (WriteCoalescer::instance().accepts()) return WriteCoalescer::instance().setScore(score);
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.write();
+        pqxx::result res = conn.exec(txn, "score_set", score.getStudentId(), score.getCourseId(), score.getScore());
+        conn.commit(txn);
+        if (!res[0]["student_ok"].as<bool>()) return ScoreResult::NoSuchStudent;
+        if (!res[0]["course_ok"].as<bool>()) return ScoreResult::NoSuchCourse;
+        if (!res[0]["enrolled"].as<bool>()) return ScoreResult::NotEnrolled;
+        return ScoreResult::Ok;
+    }
+
+    std::vector<Score> listScores(const std::string& studentId) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.read();
+        pqxx::result res = conn.exec(txn, "score_list_by_student", studentId);
+        std::vector<Score> scores;
+        scores.reserve(res.size());
+        ScoreDecoder decode(res);
+        for (const auto& row : res) scores.push_back(decode(row));
+        return scores;
+    }
+
+    // 学生信息、课程名称/学分/成绩及平均分一次查询返回
+    std::optional<Transcript> transcript(const std::string& studentId) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.read();
+        pqxx::result res = conn.exec(txn, "score_transcript", studentId);
+        if (res.empty()) return std::nullopt;
+        std::vector<TranscriptEntry> entries;
+        if (!res[0]["course_id"].is_null()) {
+            entries.reserve(res.size());
+            TranscriptEntryDecoder decode(res);
+            for (const auto& row : res) entries.push_back(decode(row));
+        }
+        return Transcript(
+            StudentDecoder(res)(res[0]),
+            std::move(entries),
+            res[0]["avg_score"].as<double>(0.0),
+            res[0]["weighted_avg"].as<double>(0.0)
+        );
+    }
+
+    // 学生/课程存在性校验、重复检测、容量占座和插入由一条语句原子完成。
+    // 课程在SeatAllocator中跟踪且已满时直接返回CourseFull，不访问数据库；开启合并写入时与其他调用方的选课一起提交
+    EnrollResult enroll(const std::string& studentId, const std::string& courseId) override {
+        auto seat = SeatAllocator::instance().reserve(courseId);
+        if (seat.rejected()) return EnrollResult::CourseFull;
+        if (WriteCoalescer::instance().accepts()) {
+            // 提交结果未知（in_doubt_error）时预占随异常归还：少计的名额只会让之后的选课多访问一次数据库
+            // （容量由语句本身保证），下次对账纠正；多计则会错误地拒绝选课
+            EnrollResult result = WriteCoalescer::instance().enroll(studentId, courseId);
+            if (result == EnrollResult::Ok) seat.confirm();
+            return result;
+        }
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.write();
+        pqxx::row row = conn.exec(txn, "enrollment_enroll", studentId, courseId)[0];
+        if (!row["inserted"].as<bool>()) {
+            conn.rollback(txn);   // 撤销可能已占的名额
+            if (!row["student_ok"].as<bool>()) return EnrollResult::NoSuchStudent;
+            if (!row["course_ok"].as<bool>()) return EnrollResult::NoSuchCourse;
+            // 占座成功但插入冲突：并发的同一选课请求先提交
+            if (row["duplicate"].as<bool>() || row["seated"].as<bool>()) return EnrollResult::AlreadyEnrolled;
+            return EnrollResult::CourseFull;
+        }
+        conn.commit(txn);
+        // 批量事务中只释放了保存点：预占随回调保留到外层提交后确认，外层回滚则随回调析构归还
+        TransactionScope::afterCommit([held = std::make_shared<SeatAllocator::Reservation>(std::move(seat))] {
+            held->confirm();
+        });
+        return EnrollResult::Ok;
+    }
+
+    // 级联删除成绩；以DELETE实际删除的行数判断是否选过该课程，避免先查后删之间被并发退课抢先而重复释放名额
+    bool dropCourse(const std::string& studentId, const std::string& courseId) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.write();
+        conn.exec(txn, "enrollment_delete_score", studentId, courseId);
+        if (conn.exec(txn, "enrollment_delete", studentId, courseId)[0]["deleted"].as<int>() == 0) {
+            conn.rollback(txn);
+            return false;
+        }
+        conn.commit(txn);
+        TransactionScope::afterCommit([courseId] { SeatAllocator::instance().release(courseId); });
+        return true;
+    }
+
+    // 选课表与课程表联表，一次查询返回完整课程信息
+    std::vector<Course> listEnrolledCourses(const std::string& studentId) override {
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.read();
+        pqxx::result res = conn.exec(txn, "enrollment_list_courses", studentId);
+        std::vector<Course> courses;
+        courses.reserve(res.size());
+        CourseDecoder decode(res);
+        for (const auto& row : res) courses.push_back(decode(row));
+        return courses;
+    }
+};
+
+// 纯内存存储后端：数据只在进程内，退出即丢失，用于演示模式和脱离数据库测量控制器/表现层。
+// 主键以及选课、成绩的（学生ID, 课程ID）复合键均为哈希索引；另按学生、按课程维护有序的选课集合，
+// 供按学生查询与级联删除使用。读操作共享锁、写操作独占锁，每个操作内部原子完成。
+// 写操作校验通过后先调用changed()再修改内存，持久化的派生类（LogStorage）在其中写日志
+class MemoryStorage : public Storage {
+protected:
+    // 数据变更：持久化时逐条记录，重放时按同样的操作重新执行（级联删除、容量检查随之重现）
+    enum class Change : std::uint8_t {
+        InsertStudent = 1, DeleteStudent, InsertTeacher, InsertCourse, SetCapacity, DeleteCourse,
+        SetScore, Enroll, Drop
+    };
+    // 变更的字段，依次为对应操作的参数；容量不限记为-1
+    using Field = std::variant<std::string_view, std::int64_t, double>;
+
+    // 各表行数，用于重建前预留哈希表容量
+    struct Counts {
+        std::uint64_t teachers = 0, courses = 0, students = 0, enrollments = 0, scores = 0;
+    };
+
+    mutable std::shared_mutex mtx;
+
+    // 变更已通过校验、即将生效时调用（持有独占锁）；抛出异常则该变更不生效
+    virtual void changed(Change, std::initializer_list<Field>) {}
+
+    Counts counts() const {
+        return Counts{teachers.size(), courses.size(), students.size(), enrollments.size(), scores.size()};
+    }
+
+    void reserve(const Counts& n) {
+        teachers.reserve(n.teachers);
+        courses.reserve(n.courses);
+        students.reserve(n.students);
+        enrollments.reserve(n.enrollments);
+        scores.reserve(n.scores);
+        coursesByStudent.reserve(n.students);
+        studentsByCourse.reserve(n.courses);
+    }
+
+    // 按能重建当前状态的顺序给出变更（调用方持有锁）：教师、课程、学生、选课及其成绩，最后是容量
+    // （容量可能被调到已选人数以下，先设容量会使重放选课失败）
+    void exportState(const std::function<void(Change, std::initializer_list<Field>)>& emit) const {
+        for (const auto& [id, t] : teachers) emit(Change::InsertTeacher, {id, t.getName(), t.getDepartment()});
+        for (const auto& [id, row] : courses) {
+            const Course& c = row.course;
+            emit(Change::InsertCourse, {id, c.getName(), std::int64_t{c.getCredit()}, c.getTeacherId()});
+        }
+        for (const auto& [id, st] : students) emit(Change::InsertStudent, {id, st.getName(), st.getMajor()});
+        for (const auto& [studentId, courseIds] : coursesByStudent) {
+            for (const auto& courseId : courseIds) {
+                emit(Change::Enroll, {studentId, courseId});
+                if (auto it = scores.find(key(studentId, courseId)); it != scores.end()) {
+                    emit(Change::SetScore, {studentId, courseId, it->second});
+                }
+            }
+        }
+        for (const auto& [id, row] : courses) {
+            if (row.capacity) emit(Change::SetCapacity, {id, std::int64_t{*row.capacity}});
+        }
+    }
+
+private:
+    struct CourseRow {
+        Course course;
+        std::optional<int> capacity;   // 为空表示不限
+        int enrolled = 0;
+    };
+
+    std::unordered_map<std::string, Student> students;
+    std::unordered_map<std::string, Teacher> teachers;
+    std::unordered_map<std::string, CourseRow> courses;
+    std::unordered_set<std::string> enrollments;                              // 键见key()
+    std::unordered_map<std::string, double> scores;                           // 键见key()
+    std::unordered_map<std::string, std::set<std::string>> coursesByStudent;  // 学生ID -> 已选课程ID
+    std::unordered_map<std::string, std::set<std::string>> studentsByCourse;  // 课程ID -> 选课学生ID
+
+    // 复合键：学生ID与课程ID以不会出现在ID中的分隔符拼接，常见长度下不额外分配内存
+    static std::string key(std::string_view studentId, std::string_view courseId) {
+        std::string k;
+        k.reserve(studentId.size() + 1 + courseId.size());
+        k.append(studentId).append(1, '\x1f').append(courseId);
+        return k;
+    }
+
+    // 按ID排序取出整张表，project从行中取出实体
+    template<typename Row, typename Project>
+    static auto sortedById(const std::unordered_map<std::string, Row>& table, Project project) {
+        std::vector<const std::pair<const std::string, Row>*> rows;
+        rows.reserve(table.size());
+        for (const auto& entry : table) rows.push_back(&entry);
+        std::ranges::sort(rows, {}, [](const auto* entry) -> const std::string& { return entry->first; });
+        std::vector<std::remove_cvref_t<std::invoke_result_t<Project&, const Row&>>> result;
+        result.reserve(rows.size());
+        for (const auto* entry : rows) result.push_back(std::invoke(project, entry->second));
+        return result;
+    }
+
+    // 删除一条选课记录及其成绩，返回删除的成绩数（调用方持有独占锁，选课记录必须存在）
+    std::size_t unenroll(const std::string& studentId, const std::string& courseId) {
+        std::string k = key(studentId, courseId);
+        enrollments.erase(k);
+        std::size_t removed = scores.erase(k);
+        if (auto it = coursesByStudent.find(studentId); it != coursesByStudent.end()) {
+            it->second.erase(courseId);
+            if (it->second.empty()) coursesByStudent.erase(it);
+        }
+        if (auto it = studentsByCourse.find(courseId); it != studentsByCourse.end()) {
+            it->second.erase(studentId);
+            if (it->second.empty()) studentsByCourse.erase(it);
+        }
+        if (auto it = courses.find(courseId); it != courses.end()) --it->second.enrolled;
+        return removed;
+    }
+
+public:
+    std::string_view name() const override { return "memory"; }
+    bool usesDatabase() const override { return false; }
+
+    void insertStudent(const Student& student) override {
+        std::unique_lock lock(mtx);
+        if (students.contains(student.getId())) return;
+        changed(Change::InsertStudent, {student.getId(), student.getName(), student.getMajor()});
+        students.emplace(student.getId(), student);
+    }
+
+    std::optional<Student> findStudent(const std::string& id) override {
+        std::shared_lock lock(mtx);
+        auto it = students.find(id);
+        if (it == students.end()) return std::nullopt;
+        return it->second;
+    }
+
+    std::vector<Student> listStudents() override {
+        std::shared_lock lock(mtx);
+        return sortedById(students, std::identity{});
+    }
+
+    // 先在锁内取出有序副本，回调在锁外执行
+    void forEachStudent(const std::function<void(const Student&)>& fn, std::size_t) override {
+        for (const auto& student : listStudents()) fn(student);
+    }
+
+    std::optional<CascadeDeleteResult> deleteStudent(const std::string& id) override {
+        std::unique_lock lock(mtx);
+        auto it = students.find(id);
+        if (it == students.end()) return std::nullopt;
+        changed(Change::DeleteStudent, {id});
+        CascadeDeleteResult result;
+        if (auto enrolled = coursesByStudent.find(id); enrolled != coursesByStudent.end()) {
+            std::set<std::string> courseIds = std::move(enrolled->second);
+            for (const auto& courseId : courseIds) {
+                result.scores += unenroll(id, courseId);
+                ++result.enrollments;
+            }
+            coursesByStudent.erase(id);
+        }
+        students.erase(it);
+        return result;
+    }
+
+    void insertTeacher(const Teacher& teacher) override {
+        std::unique_lock lock(mtx);
+        if (teachers.contains(teacher.getId())) return;
+        changed(Change::InsertTeacher, {teacher.getId(), teacher.getName(), teacher.getDepartment()});
+        teachers.emplace(teacher.getId(), teacher);
+    }
+
+    std::optional<Teacher> findTeacher(const std::string& id) override {
+        std::shared_lock lock(mtx);
+        auto it = teachers.find(id);
+        if (it == teachers.end()) return std::nullopt;
+        return it->second;
+    }
+
+    // 与courses.teacher_id外键一致：课程ID不存在且教师不存在时报错
+    void insertCourse(const Course& course) override {
+        std::unique_lock lock(mtx);
+        if (courses.contains(course.getId())) return;
+        if (!teachers.contains(course.getTeacherId())) {
+            throw std::runtime_error("教师ID【" + course.getTeacherId() + "】不存在");
+        }
+        changed(Change::InsertCourse, {course.getId(), course.getName(), std::int64_t{course.getCredit()}, course.getTeacherId()});
+        courses.emplace(course.getId(), CourseRow{course, std::nullopt, 0});
+    }
+
+    std::optional<Course> findCourse(const std::string& id) override {
+        std::shared_lock lock(mtx);
+        auto it = courses.find(id);
+        if (it == courses.end()) return std::nullopt;
+        return it->second.course;
+    }
+
+    std::vector<Course> findCourses(std::span<const std::string> ids) override {
+        std::vector<std::string_view> sorted(ids.begin(), ids.end());
+        std::ranges::sort(sorted);
+        sorted.erase(std::ranges::unique(sorted).begin(), sorted.end());
+        std::shared_lock lock(mtx);
+        std::vector<Course> result;
+        result.reserve(sorted.size());
+        for (auto id : sorted) {
+            if (auto it = courses.find(std::string(id)); it != courses.end()) result.push_back(it->second.course);
+        }
+        return result;
+    }
+
+    std::vector<Course> listCourses() override {
+        std::shared_lock lock(mtx);
+        return sortedById(courses, &CourseRow::course);
+    }
+
+    void forEachCourse(const std::function<void(const Course&)>& fn, std::size_t) override {
+        for (const auto& course : listCourses()) fn(course);
+    }
+
+    bool setCapacity(const std::string& id, std::optional<int> capacity) override {
+        std::unique_lock lock(mtx);
+        auto it = courses.find(id);
+        if (it == courses.end()) return false;
+        changed(Change::SetCapacity, {id, std::int64_t{capacity.value_or(-1)}});
+        it->second.capacity = capacity;
+        return true;
+    }
+
+    // 内存中一次完成，不分批
+    std::optional<CascadeDeleteResult> deleteCourse(const std::string& id, std::size_t) override {
+        std::unique_lock lock(mtx);
+        auto it = courses.find(id);
+        if (it == courses.end()) return std::nullopt;
+        changed(Change::DeleteCourse, {id});
+        CascadeDeleteResult result;
+        if (auto enrolled = studentsByCourse.find(id); enrolled != studentsByCourse.end()) {
+            std::set<std::string> studentIds = std::move(enrolled->second);
+            for (const auto& studentId : studentIds) {
+                result.scores += unenroll(studentId, id);
+                ++result.enrollments;
+            }
+            studentsByCourse.erase(id);
+        }
+        courses.erase(id);
+        return result;
+    }
+
+    ScoreResult setScore(const Score& score) override {
+        std::unique_lock lock(mtx);
+        if (!students.contains(score.getStudentId())) return ScoreResult::NoSuchStudent;
+        if (!courses.contains(score.getCourseId())) return ScoreResult::NoSuchCourse;
+        std::string k = key(score.getStudentId(), score.getCourseId());
+        if (!enrollments.contains(k)) return ScoreResult::NotEnrolled;
+        changed(Change::SetScore, {score.getStudentId(), score.getCourseId(), score.getScore()});
+        scores.insert_or_assign(std::move(k), score.getScore());
+        return ScoreResult::Ok;
+    }
+
+    std::vector<Score> listScores(const std::string& studentId) override {
+        std::shared_lock lock(mtx);
+        std::vector<Score> result;
+        auto enrolled = coursesByStudent.find(studentId);
+        if (enrolled == coursesByStudent.end()) return result;
+        for (const auto& courseId : enrolled->second) {
+            if (auto it = scores.find(key(studentId, courseId)); it != scores.end()) {
+                result.emplace_back(studentId, courseId, it->second);
+            }
+        }
+        return result;
+    }
+
+    // 平均分与学分加权平均分的算法与score_transcript一致（总学分为0时加权平均分记为0）
+    std::optional<Transcript> transcript(const std::string& studentId) override {
+        std::shared_lock lock(mtx);
+        auto student = students.find(studentId);
+        if (student == students.end()) return std::nullopt;
+        std::vector<TranscriptEntry> entries;
+        double sum = 0.0, weighted = 0.0;
+        long credits = 0;
+        if (auto enrolled = coursesByStudent.find(studentId); enrolled != coursesByStudent.end()) {
+            for (const auto& courseId : enrolled->second) {
+                auto score = scores.find(key(studentId, courseId));
+                if (score == scores.end()) continue;
+                const Course& course = courses.at(courseId).course;
+                entries.emplace_back(courseId, course.getName(), course.getCredit(), score->second);
+                sum += score->second;
+                weighted += score->second * course.getCredit();
+                credits += course.getCredit();
+            }
+        }
+        double average = entries.empty() ? 0.0 : sum / static_cast<double>(entries.size());
+        double weightedAverage = credits == 0 ? 0.0 : weighted / static_cast<double>(credits);
+        return Transcript(student->second, std::move(entries), average, weightedAverage);
+    }
+
+    // 校验顺序与enrollment_enroll一致：学生、课程、重复选课、容量
+    EnrollResult enroll(const std::string& studentId, const std::string& courseId) override {
+        std::unique_lock lock(mtx);
+        if (!students.contains(studentId)) return EnrollResult::NoSuchStudent;
+        auto course = courses.find(courseId);
+        if (course == courses.end()) return EnrollResult::NoSuchCourse;
+        std::string k = key(studentId, courseId);
+        if (enrollments.contains(k)) return EnrollResult::AlreadyEnrolled;
+        CourseRow& row = course->second;
+        if (row.capacity && row.enrolled >= *row.capacity) return EnrollResult::CourseFull;
+        changed(Change::Enroll, {studentId, courseId});
+        enrollments.insert(std::move(k));
+        coursesByStudent[studentId].insert(courseId);
+        studentsByCourse[courseId].insert(studentId);
+        ++row.enrolled;
+        return EnrollResult::Ok;
+    }
+
+    bool dropCourse(const std::string& studentId, const std::string& courseId) override {
+        std::unique_lock lock(mtx);
+        if (!enrollments.contains(key(studentId, courseId))) return false;
+        changed(Change::Drop, {studentId, courseId});
+        unenroll(studentId, courseId);
+        return true;
+    }
+
+    std::vector<Course> listEnrolledCourses(const std::string& studentId) override {
+        std::shared_lock lock(mtx);
+        std::vector<Course> result;
+        auto enrolled = coursesByStudent.find(studentId);
+        if (enrolled == coursesByStudent.end()) return result;
+        result.reserve(enrolled->second.size());
+        for (const auto& courseId : enrolled->second) result.push_back(courses.at(courseId).course);
+        return result;
+    }
+};
+
+// 本地持久化存储后端：内存表与索引同MemoryStorage，每个变更先追加到内存映射的日志文件再生效，适合单机部署。
+// 文件 = 文件头 + 记录序列，记录 = 长度(u32) + CRC32(u32) + 变更类型(u8) + 字段（本机字节序）。
+// 启动时把整个文件映射进内存顺序重放，遇到长度为0或校验不符的记录即为日志末尾（崩溃时写了一半的记录被丢弃）。
+// 写操作追加记录后等待后台刷盘线程确认：一次fdatasync覆盖此前所有线程追加的记录（组提交）；
+// 内存中的变更在追加后即对读操作可见，早于刷盘确认。
+// 日志超过上次压缩后大小的LOG_COMPACT_RATIO倍时由后台线程压缩：把当前状态写成新文件后原子替换，
+// 新文件即索引快照，文件头记录各表行数，启动时据此预留哈希表容量，重放期间不再扩容
+class LogStorage : public MemoryStorage {
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t size;        // 文件头字节数，记录从此处开始
+        Counts counts;             // 压缩时的各表行数
+    };
+    static constexpr char MAGIC[8] = {'S', 'S', 'Y', 'S', 'L', 'O', 'G', '\0'};
+    static constexpr std::uint32_t VERSION = 1;
+    static constexpr std::size_t RECORD_PREFIX = 8;   // 长度 + CRC32
+
+    std::string path;
+    int fd = -1;
+    char* base = nullptr;
+    std::size_t mapped = 0;
+    std::size_t end = 0;              // 有效记录的结尾，即下一条记录的写入位置（持有独占锁时读写）
+    std::size_t compactedSize = 0;    // 上次压缩（或启动）时的日志大小
+    bool replaying = false;
+    std::string record;               // 编码缓冲区（持有独占锁时使用）
+
+    std::mutex fileMtx;               // 刷盘与压缩换文件互斥
+    std::mutex compactMtx;            // 同一时刻只进行一次压缩
+    std::mutex syncMtx;
+    std::condition_variable_any flushNeeded;
+    std::condition_variable flushDone;
+    std::uint64_t appended = 0;       // 本进程累计追加的字节数（日志序号）
+    std::uint64_t flushed = 0;        // 已确认刷盘的日志序号
+    std::string syncError;            // 刷盘失败后不再确认任何写入
+    std::jthread flusher;
+    std::jthread compactor;
+
+    // 当前线程最近一次追加的日志序号，写操作返回前等待其刷盘
+    static std::uint64_t& pendingLsn() {
+        thread_local std::uint64_t lsn = 0;
+        return lsn;
+    }
+
+    static std::uint32_t crc32(std::string_view data) {
+        static const auto table = [] {
+            std::array<std::uint32_t, 256> t{};
+            for (std::uint32_t i = 0; i < 256; ++i) {
+                std::uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+        std::uint32_t c = 0xFFFFFFFFu;
+        for (unsigned char ch : data) c = table[(c ^ ch) & 0xFF] ^ (c >> 8);
+        return c ^ 0xFFFFFFFFu;
+    }
+
+    [[noreturn]] static void fail(const std::string& what) {
+        throw std::runtime_error(what + "：" + std::strerror(errno));
+    }
+
+    template<typename T>
+    static void put(std::string& out, const T& value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    // 把一条变更编码为完整记录（含长度与校验）
+    static void encode(std::string& out, Change change, std::initializer_list<Field> fields) {
+        std::size_t start = out.size();
+        out.append(RECORD_PREFIX, '\0');
+        out += static_cast<char>(change);
+        for (const auto& field : fields) {
+            if (const auto* text = std::get_if<std::string_view>(&field)) {
+                put(out, static_cast<std::uint32_t>(text->size()));
+                out.append(*text);
+            } else if (const auto* number = std::get_if<std::int64_t>(&field)) {
+                put(out, *number);
+            } else {
+                put(out, std::get<double>(field));
+            }
+        }
+        std::string_view body(out.data() + start + RECORD_PREFIX, out.size() - start - RECORD_PREFIX);
+        std::uint32_t length = static_cast<std::uint32_t>(body.size()), crc = crc32(body);
+        std::memcpy(out.data() + start, &length, sizeof(length));
+        std::memcpy(out.data() + start + sizeof(length), &crc, sizeof(crc));
+    }
+
+    // 记录字段的顺序读取，越界说明记录与版本不符
+    class Reader {
+    private:
+        std::string_view data;
+        template<typename T>
+        T get() {
+            if (data.size() < sizeof(T)) throw std::runtime_error("日志记录不完整");
+            T value;
+            std::memcpy(&value, data.data(), sizeof(T));
+            data.remove_prefix(sizeof(T));
+            return value;
+        }
+    public:
+        explicit Reader(std::string_view data) : data(data) {}
+        std::string text() {
+            auto size = get<std::uint32_t>();
+            if (data.size() < size) throw std::runtime_error("日志记录不完整");
+            std::string value(data.substr(0, size));
+            data.remove_prefix(size);
+            return value;
+        }
+        std::int64_t integer() { return get<std::int64_t>(); }
+        double real() { return get<double>(); }
+    };
+
+    // 重放一条记录：经MemoryStorage的同名操作执行，校验与级联逻辑与写入时一致
+    void apply(Change change, Reader in) {
+        switch (change) {
+            case Change::InsertStudent: {
+                auto id = in.text(), name = in.text(), major = in.text();
+                MemoryStorage::insertStudent(Student(std::move(id), std::move(name), std::move(major)));
+                break;
+            }
+            case Change::DeleteStudent: MemoryStorage::deleteStudent(in.text()); break;
+            case Change::InsertTeacher: {
+                auto id = in.text(), name = in.text(), department = in.text();
+                MemoryStorage::insertTeacher(Teacher(std::move(id), std::move(name), std::move(department)));
+                break;
+            }
+            case Change::InsertCourse: {
+                auto id = in.text(), name = in.text();
+                auto credit = static_cast<int>(in.integer());
+                MemoryStorage::insertCourse(Course(std::move(id), std::move(name), credit, in.text()));
+                break;
+            }
+            case Change::SetCapacity: {
+                auto id = in.text();
+                auto capacity = in.integer();
+                MemoryStorage::setCapacity(id, capacity < 0 ? std::nullopt : std::optional<int>(static_cast<int>(capacity)));
+                break;
+            }
+            case Change::DeleteCourse: MemoryStorage::deleteCourse(in.text(), 0); break;
+            case Change::SetScore: {
+                auto studentId = in.text(), courseId = in.text();
+                MemoryStorage::setScore(Score(std::move(studentId), std::move(courseId), in.real()));
+                break;
+            }
+            case Change::Enroll: {
+                auto studentId = in.text(), courseId = in.text();
+                MemoryStorage::enroll(studentId, courseId);
+                break;
+            }
+            case Change::Drop: {
+                auto studentId = in.text(), courseId = in.text();
+                MemoryStorage::dropCourse(studentId, courseId);
+                break;
+            }
+            default: throw std::runtime_error("未知的日志记录类型：" + std::to_string(static_cast<int>(change)));
+        }
+    }
+
+    void map(std::size_t size) {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) fail("映射数据文件失败");
+        base = static_cast<char*>(p);
+        mapped = size;
+    }
+
+    // 保证映射区能容纳needed字节：按LOG_GROW_BYTES扩展文件并重新映射
+    void ensureCapacity(std::size_t needed) {
+        if (needed <= mapped) return;
+        std::size_t size = (needed / LOG_GROW_BYTES + 1) * LOG_GROW_BYTES;
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0) fail("扩展数据文件失败");
+        void* p = ::mremap(base, mapped, size, MREMAP_MAYMOVE);
+        if (p == MAP_FAILED) fail("重新映射数据文件失败");
+        base = static_cast<char*>(p);
+        mapped = size;
+    }
+
+    // 打开数据文件并重放全部记录；文件不存在时新建
+    void open() {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) fail("打开数据文件失败（" + path + "）");
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) fail("读取数据文件信息失败");
+        if (st.st_size == 0) {
+            Header header{};
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = VERSION;
+            header.size = sizeof(Header);
+            if (::ftruncate(fd, static_cast<off_t>(LOG_GROW_BYTES)) != 0) fail("扩展数据文件失败");
+            map(LOG_GROW_BYTES);
+            std::memcpy(base, &header, sizeof(header));
+            if (::fdatasync(fd) != 0) fail("数据文件刷盘失败");
+        } else {
+            map(static_cast<std::size_t>(st.st_size));
+        }
+        Header header{};
+        if (mapped < sizeof(Header)) throw std::runtime_error("数据文件格式错误：" + path);
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+            throw std::runtime_error("数据文件格式或版本不符：" + path);
+        }
+        reserve(header.counts);
+
+        ::madvise(base, mapped, MADV_SEQUENTIAL);
+        replaying = true;
+        std::size_t offset = header.size;
+        while (offset + RECORD_PREFIX <= mapped) {
+            std::uint32_t length, crc;
+            std::memcpy(&length, base + offset, sizeof(length));
+            std::memcpy(&crc, base + offset + sizeof(length), sizeof(crc));
+            if (length == 0 || length > mapped - offset - RECORD_PREFIX) break;
+            std::string_view body(base + offset + RECORD_PREFIX, length);
+            if (crc32(body) != crc) break;
+            apply(static_cast<Change>(body[0]), Reader(body.substr(1)));
+            offset += RECORD_PREFIX + length;
+        }
+        // 最后一条有效记录之后应全为零。写了一半的记录及其后残留的字节一并清零并刷盘：
+        // 否则新追加的记录较短时，下次重放可能越过它接着读到看似有效的旧数据
+        if (std::any_of(base + offset, base + mapped, [](char ch) { return ch != 0; })) {
+            std::memset(base + offset, 0, mapped - offset);
+            if (::fdatasync(fd) != 0) fail("数据文件刷盘失败");
+        }
+        replaying = false;
+        ::madvise(base, mapped, MADV_NORMAL);
+        end = compactedSize = offset;
+    }
+
+    // 组提交：等到有新追加的记录时执行一次fdatasync，确认期间累积的全部记录
+    void flushLoop(std::stop_token stop) {
+        std::unique_lock lock(syncMtx);
+        while (true) {
+            flushNeeded.wait(lock, stop, [this] { return appended > flushed; });
+            if (appended == flushed) return;
+            std::uint64_t target = appended;
+            lock.unlock();
+            int rc = 0;
+            {
+                std::lock_guard file(fileMtx);
+                rc = ::fdatasync(fd);
+            }
+            std::string error = rc != 0 ? std::strerror(errno) : std::string();
+            lock.lock();
+            if (!error.empty() && syncError.empty()) syncError = error;
+            flushed = std::max(flushed, target);
+            flushDone.notify_all();
+        }
+    }
+
+    void compactLoop(std::stop_token stop) {
+        std::mutex m;
+        std::condition_variable_any cv;
+        while (true) {
+            std::unique_lock lock(m);
+            cv.wait_for(lock, stop, LOG_COMPACT_INTERVAL, [] { return false; });
+            if (stop.stop_requested()) break;
+            bool due = false;
+            {
+                std::shared_lock state(mtx);
+                due = end > std::max(LOG_COMPACT_MIN_BYTES, compactedSize * LOG_COMPACT_RATIO);
+            }
+            try {
+                if (due) compact();
+            } catch (const std::exception& e) {
+                std::cerr << "日志压缩失败：" << e.what() << '\n';
+            }
+        }
+    }
+
+    // 等待当前线程追加的记录刷盘
+    void awaitDurable() {
+        std::uint64_t lsn = std::exchange(pendingLsn(), 0);
+        if (lsn == 0) return;
+        std::unique_lock lock(syncMtx);
+        flushDone.wait(lock, [&] { return flushed >= lsn || !syncError.empty(); });
+        if (!syncError.empty()) throw std::runtime_error("数据文件刷盘失败：" + syncError);
+    }
+
+protected:
+    // 先把变更追加到日志，再由MemoryStorage修改内存；扩展文件失败时抛异常，变更不生效
+    void changed(Change change, std::initializer_list<Field> fields) override {
+        if (replaying) return;
+        record.clear();
+        encode(record, change, fields);
+        ensureCapacity(end + record.size());
+        std::memcpy(base + end, record.data(), record.size());
+        end += record.size();
+        {
+            std::lock_guard lock(syncMtx);
+            appended += record.size();
+            pendingLsn() = appended;
+        }
+        flushNeeded.notify_one();
+    }
+
+public:
+    // 数据文件：环境变量STUDENT_SYS_DATA优先于LOG_STORAGE_PATH
+    static std::string defaultPath() {
+        const char* env = std::getenv("STUDENT_SYS_DATA");
+        return env && *env ? std::string(env) : LOG_STORAGE_PATH;
+    }
+
+    explicit LogStorage(std::string path = defaultPath()) : path(std::move(path)) {
+        try {
+            open();
+        } catch (...) {
+            if (base) ::munmap(base, mapped);
+            if (fd >= 0) ::close(fd);
+            throw;
+        }
+        flusher = std::jthread([this](std::stop_token stop) { flushLoop(stop); });
+        compactor = std::jthread([this](std::stop_token stop) { compactLoop(stop); });
+    }
+    LogStorage(const LogStorage&) = delete;
+    LogStorage& operator=(const LogStorage&) = delete;
+
+    // 停止压缩，刷完剩余记录后关闭文件
+    ~LogStorage() override {
+        compactor = std::jthread();
+        flusher = std::jthread();
+        ::munmap(base, mapped);
+        ::close(fd);
+    }
+
+    std::string_view name() const override { return "log"; }
+
+    // 压缩：持有共享锁把当前状态编码到内存（读操作不受影响，写操作只等待编码），不持锁写入临时文件并刷盘；
+    // 再持独占锁补写编码之后追加的记录，原子替换数据文件并切换映射。
+    // 新文件包含全部已生效的变更，此前追加但尚未刷盘的记录随之确认
+    void compact() {
+        std::lock_guard serial(compactMtx);
+        std::string buffer;
+        std::size_t snapshotEnd = 0;
+        {
+            std::shared_lock state(mtx);
+            Header header{};
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = VERSION;
+            header.size = sizeof(Header);
+            header.counts = counts();
+            buffer.assign(reinterpret_cast<const char*>(&header), sizeof(header));
+            exportState([&](Change change, std::initializer_list<Field> fields) { encode(buffer, change, fields); });
+            snapshotEnd = end;
+        }
+
+        const std::string temp = path + ".compact";
+        int out = ::open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (out < 0) fail("创建压缩文件失败");
+        std::size_t written = 0;
+        auto writeAll = [&](const char* data, std::size_t size) {
+            for (std::size_t done = 0; done < size;) {
+                ssize_t n = ::write(out, data + done, size - done);
+                if (n < 0 && errno != EINTR) fail("写入压缩文件失败");
+                if (n > 0) done += static_cast<std::size_t>(n);
+            }
+            written += size;
+        };
+        try {
+            writeAll(buffer.data(), buffer.size());
+            if (::fdatasync(out) != 0) fail("压缩文件刷盘失败");
+        } catch (...) {
+            ::close(out);
+            ::unlink(temp.c_str());
+            throw;
+        }
+        buffer = std::string();
+
+        std::unique_lock state(mtx);
+        std::size_t size = 0; // 新文件长度由下面的ftruncate决定，映射时直接使用，不再fstat
+        try {
+            writeAll(base + snapshotEnd, end - snapshotEnd);
+            size = (written / LOG_GROW_BYTES + 1) * LOG_GROW_BYTES;
+            if (::ftruncate(out, static_cast<off_t>(size)) != 0) {
+                fail("扩展压缩文件失败");
+            }
+            if (::fdatasync(out) != 0) fail("压缩文件刷盘失败");
+            if (::rename(temp.c_str(), path.c_str()) != 0) fail("替换数据文件失败");
+        } catch (...) {
+            ::close(out);
+            ::unlink(temp.c_str());
+            throw;
+        }
+        // 目录项刷盘后替换才算持久，之后新文件上的刷盘才能确认写入
+        std::string dir = std::filesystem::path(path).parent_path().string();
+        if (int d = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC); d >= 0) {
+            ::fsync(d);
+            ::close(d);
+        }
+        {
+            std::lock_guard file(fileMtx);
+            ::munmap(base, mapped);
+            ::close(fd);
+            fd = out;
+            map(size);
+        }
+        end = compactedSize = written;
+        std::lock_guard lock(syncMtx);
+        flushed = appended;
+        flushDone.notify_all();
+    }
+
+    void insertStudent(const Student& student) override { MemoryStorage::insertStudent(student); awaitDurable(); }
+
+    std::optional<CascadeDeleteResult> deleteStudent(const std::string& id) override {
+        auto result = MemoryStorage::deleteStudent(id);
+        awaitDurable();
+        return result;
+    }
+
+    void insertTeacher(const Teacher& teacher) override { MemoryStorage::insertTeacher(teacher); awaitDurable(); }
+
+    void insertCourse(const Course& course) override { MemoryStorage::insertCourse(course); awaitDurable(); }
+
+    bool setCapacity(const std::string& id, std::optional<int> capacity) override {
+        bool found = MemoryStorage::setCapacity(id, capacity);
+        awaitDurable();
+        return found;
+    }
+
+    std::optional<CascadeDeleteResult> deleteCourse(const std::string& id, std::size_t chunkSize) override {
+        auto result = MemoryStorage::deleteCourse(id, chunkSize);
+        awaitDurable();
+        return result;
+    }
+
+    ScoreResult setScore(const Score& score) override {
+        ScoreResult result = MemoryStorage::setScore(score);
+        awaitDurable();
+        return result;
+    }
+
+    EnrollResult enroll(const std::string& studentId, const std::string& courseId) override {
+        EnrollResult result = MemoryStorage::enroll(studentId, courseId);
+        awaitDurable();
+        return result;
+    }
+
+    bool dropCourse(const std::string& studentId, const std::string& courseId) override {
+        bool dropped = MemoryStorage::dropCourse(studentId, courseId);
+        awaitDurable();
+        return dropped;
+    }
+};
+
+inline std::string& Storage::backendName() {
+    static std::string value = [] {
+        const char* env = std::getenv("STUDENT_SYS_STORAGE");
+        return env && *env ? std::string(env) : std::string("postgres");
+    }();
+    return value;
+}
+
+inline Storage& Storage::current() {
+    static const std::unique_ptr<Storage> instance = []() -> std::unique_ptr<Storage> {
+        if (backendName() == "postgres") return std::make_unique<PostgresStorage>();
+        if (backendName() == "memory") return std::make_unique<MemoryStorage>();
+        if (backendName() == "log") return std::make_unique<LogStorage>();
+        throw std::runtime_error("未知的存储后端：" + backendName() + "（可选postgres、memory、log）");
+    }();
+    return *instance;
+}
+
+class StudentRepository {
+public:
+    // 新增学生
+    void addStudent(const Student& student) {
+        OperationTimer timer;
+        try {
+            Storage::current().insertStudent(student);
+            std::cout << "学生【" << student.getName() << "】新增成功！" << '\n';
+        } catch (const std::exception& e) {
+            throw std::runtime_error("新增学生失败：" + std::string(e.what()));
+        }
+    }
+
+    // 根据ID查询学生
+    Student getStudentById(const std::string& id) {
+        OperationTimer timer;
+        try {
+            auto student = Storage::current().findStudent(id);
+            if (!student) throw std::runtime_error("学生ID【" + id + "】不存在");
+            return std::move(*student);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询学生失败：" + std::string(e.what()));
+        }
+    }
+
+    // 根据ID查询学生，不存在时返回空（计为失败），只有存储错误抛异常
+    std::optional<Student> findStudent(const std::string& id) {
+        OperationTimer timer;
+        try {
+            auto student = Storage::current().findStudent(id);
+            if (!student) timer.fail();
+            return student;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询学生失败：" + std::string(e.what()));
+        }
+    }
+
+    // 查询所有学生
+    std::vector<Student> getAllStudents() {
+        OperationTimer timer;
+        try {
+            return Storage::current().listStudents();
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询所有学生失败：" + std::string(e.what()));
+        }
+    }
+
+    // 流式遍历所有学生：按ID顺序分批拉取，内存占用与表大小无关
+    void forEachStudent(const std::function<void(const Student&)>& fn, std::size_t fetchSize = DB_FETCH_SIZE) {
+        OperationTimer timer;
+        try {
+            Storage::current().forEachStudent(fn, fetchSize);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询所有学生失败：" + std::string(e.what()));
+        }
+    }
+
+    // 删除学生：级联删除选课和成绩记录，原子完成
+    CascadeDeleteResult deleteStudent(const std::string& id) {
+        OperationTimer timer;
+        try {
+            auto result = Storage::current().deleteStudent(id);
+            if (!result) throw std::runtime_error("学生ID【" + id + "】不存在");
+            std::cout << "学生ID【" << id << "】删除成功（含选课" << result->enrollments << "条、成绩"
+                      << result->scores << "条）！" << '\n';
+            return *result;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("删除学生失败：" + std::string(e.what()));
+        }
+    }
+
+    // 删除学生，不存在时返回空（计为失败），不输出提示
+    std::optional<CascadeDeleteResult> tryDeleteStudent(const std::string& id) {
+        OperationTimer timer;
+        try {
+            auto result = Storage::current().deleteStudent(id);
+            if (!result) timer.fail();
+            return result;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("删除学生失败：" + std::string(e.what()));
+        }
+    }
+};
+
+class TeacherRepository {
+public:
+    // 新增教师
+    void addTeacher(const Teacher& teacher) {
+        OperationTimer timer;
+        try {
+            Storage::current().insertTeacher(teacher);
+            std::cout << "教师【" << teacher.getName() << "】新增成功！" << '\n';
+        } catch (const std::exception& e) {
+            throw std::runtime_error("新增教师失败：" + std::string(e.what()));
+        }
+    }
+
+    // 根据ID查询教师
+    Teacher getTeacherById(const std::string& id) {
+        OperationTimer timer;
+        try {
+            auto teacher = Storage::current().findTeacher(id);
+            if (!teacher) throw std::runtime_error("教师ID【" + id + "】不存在");
+            return std::move(*teacher);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询教师失败：" + std::string(e.what()));
+        }
+    }
+
+    // 根据ID查询教师，不存在时返回空（计为失败）
+    std::optional<Teacher> findTeacher(const std::string& id) {
+        OperationTimer timer;
+        try {
+            auto teacher = Storage::current().findTeacher(id);
+            if (!teacher) timer.fail();
+            return teacher;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询教师失败：" + std::string(e.what()));
+        }
+    }
+};
+
+class CourseRepository {
+public:
+    // 新增课程
+    void addCourse(const Course& course) {
+        OperationTimer timer;
+        try {
+            Storage::current().insertCourse(course);
+            std::cout << "课程【" << course.getName() << "】新增成功！" << '\n';
+        } catch (const std::exception& e) {
+            throw std::runtime_error("新增课程失败：" + std::string(e.what()));
+        }
+    }
+
+    // 根据ID查询课程
+    Course getCourseById(const std::string& id) {
+        OperationTimer timer;
+        try {
+            auto course = Storage::current().findCourse(id);
+            if (!course) throw std::runtime_error("课程ID【" + id + "】不存在");
+            return std::move(*course);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询课程失败：" + std::string(e.what()));
+        }
+    }
+
+    // 根据ID查询课程，不存在时返回空（计为失败）
+    std::optional<Course> findCourse(const std::string& id) {
+        OperationTimer timer;
+        try {
+            auto course = Storage::current().findCourse(id);
+            if (!course) timer.fail();
+            return course;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询课程失败：" + std::string(e.what()));
+        }
+    }
+
+    // 批量查询课程：一次查询返回所有存在的课程（按ID排序），不存在的ID被忽略
+    std::vector<Course> getCoursesByIds(std::span<const std::string> ids) {
+        OperationTimer timer;
+        if (ids.empty()) return {};
+        try {
+            return Storage::current().findCourses(ids);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("批量查询课程失败：" + std::string(e.what()));
+        }
+    }
+
+    // 查询所有课程
+    std::vector<Course> getAllCourses() {
+        OperationTimer timer;
+        try {
+            return Storage::current().listCourses();
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询所有课程失败：" + std::string(e.what()));
+        }
+    }
+
+    // 流式遍历所有课程：按ID顺序分批拉取，内存占用与表大小无关
+    void forEachCourse(const std::function<void(const Course&)>& fn, std::size_t fetchSize = DB_FETCH_SIZE) {
+        OperationTimer timer;
+        try {
+            Storage::current().forEachCourse(fn, fetchSize);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询所有课程失败：" + std::string(e.what()));
+        }
+    }
+
+    // 设置课程容量：std::nullopt表示不限；已选人数超过新容量时不退课，只是不再接受新的选课
+    void setCapacity(const std::string& id, std::optional<int> capacity) {
+        OperationTimer timer;
+        try {
+            if (!Storage::current().setCapacity(id, capacity)) {
+                throw std::runtime_error("课程ID【" + id + "】不存在");
+            }
+            std::cout << "课程ID【" << id << "】容量已设为" << (capacity ? std::to_string(*capacity) : "不限") << '\n';
+        } catch (const std::exception& e) {
+            throw std::runtime_error("设置课程容量失败：" + std::string(e.what()));
+        }
+    }
+
+    // 设置课程容量，课程不存在时返回false（计为失败），不输出提示
+    bool trySetCapacity(const std::string& id, std::optional<int> capacity) {
+        OperationTimer timer;
+        try {
+            if (Storage::current().setCapacity(id, capacity)) return true;
+            timer.fail();
+            return false;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("设置课程容量失败：" + std::string(e.what()));
+        }
+    }
+
+    // 删除课程：级联删除选课和成绩记录。chunkSize大于0时数据库后端分多个短事务删除（见PostgresStorage）
+    CascadeDeleteResult deleteCourse(const std::string& id, std::size_t chunkSize = 0) {
+        OperationTimer timer;
+        try {
+            auto result = Storage::current().deleteCourse(id, chunkSize);
+            if (!result) throw std::runtime_error("课程ID【" + id + "】不存在");
+            std::cout << "课程ID【" << id << "】删除成功（含选课" << result->enrollments << "条、成绩"
+                      << result->scores << "条，共" << result->batches << "个事务）！" << '\n';
+            return *result;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("删除课程失败：" + std::string(e.what()));
+        }
+    }
+
+    // 删除课程，不存在时返回空（计为失败），不输出提示
+    std::optional<CascadeDeleteResult> tryDeleteCourse(const std::string& id, std::size_t chunkSize = 0) {
+        OperationTimer timer;
+        try {
+            auto result = Storage::current().deleteCourse(id, chunkSize);
+            if (!result) timer.fail();
+            return result;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("删除课程失败：" + std::string(e.what()));
+        }
+    }
+};
+
+class ScoreRepository {
+public:
+    // 录入/更新成绩：选课校验与upsert原子完成；未满足的前置条件通过返回值表示，存储错误抛异常
+    ScoreResult setScore(const Score& score) {
+        OperationTimer timer;
+        try {
+            return Storage::current().setScore(score);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("成绩操作失败：" + std::string(e.what()));
+        }
+    }
+
+    // 查询学生所有成绩
+    std::vector<Score> getScoresByStudentId(const std::string& studentId) {
+        OperationTimer timer;
+        try {
+            std::vector<Score> scores = Storage::current().listScores(studentId);
+            if (scores.empty()) throw std::runtime_error("该学生暂无成绩记录");
+            return scores;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询成绩失败：" + std::string(e.what()));
+        }
+    }
+
+    // 查询学生成绩单：学生信息、课程名称/学分/成绩及平均分一次返回
+    Transcript getTranscript(const std::string& studentId) {
+        OperationTimer timer;
+        try {
+            auto transcript = Storage::current().transcript(studentId);
+            if (!transcript) throw std::runtime_error("学生ID【" + studentId + "】不存在");
+            if (transcript->getEntries().empty()) throw std::runtime_error("该学生暂无成绩记录");
+            return std::move(*transcript);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询成绩失败：" + std::string(e.what()));
+        }
+    }
+
+    // 查询学生成绩单，学生不存在时返回空（计为失败）；暂无成绩时返回空的成绩单
+    std::optional<Transcript> findTranscript(const std::string& studentId) {
+        OperationTimer timer;
+        try {
+            auto transcript = Storage::current().transcript(studentId);
+            if (!transcript) timer.fail();
+            return transcript;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询成绩失败：" + std::string(e.what()));
+        }
+    }
+};
+
+class EnrollmentRepository {
+public:
+    // 选课：学生/课程存在性校验、重复检测、容量占座和插入原子完成；业务失败通过返回值表示，存储错误抛异常
+    EnrollResult enroll(const std::string& studentId, const std::string& courseId) {
+        OperationTimer timer;
+        try {
+            return Storage::current().enroll(studentId, courseId);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("选课失败：" + std::string(e.what()));
+        }
+    }
+
+    // 退课
+    void dropCourse(const std::string& studentId, const std::string& courseId) {
+        OperationTimer timer;
+        try {
+            if (!Storage::current().dropCourse(studentId, courseId)) {
+                throw std::runtime_error("未选该课程，无法退课");
+            }
+            std::cout << "学生【" << studentId << "】退课【" << courseId << "】成功！" << '\n';
+        } catch (const std::exception& e) {
+            throw std::runtime_error("退课失败：" + std::string(e.what()));
+        }
+    }
+
+    // 退课，未选该课程时返回false（计为失败），不输出提示
+    bool tryDropCourse(const std::string& studentId, const std::string& courseId) {
+        OperationTimer timer;
+        try {
+            if (Storage::current().dropCourse(studentId, courseId)) return true;
+            timer.fail();
+            return false;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("退课失败：" + std::string(e.what()));
+        }
+    }
+
+    // 查询学生已选课程（含完整课程信息）
+    std::vector<Course> getEnrolledCourses(const std::string& studentId) {
+        OperationTimer timer;
+        try {
+            std::vector<Course> courses = Storage::current().listEnrolledCourses(studentId);
+            if (courses.empty()) throw std::runtime_error("该学生暂无选课记录");
+            return courses;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询选课记录失败：" + std::string(e.what()));
+        }
+    }
+
+    // 查询学生已选课程，学生不存在时返回空（计为失败）；暂无选课时返回空列表
+    std::optional<std::vector<Course>> findEnrolledCourses(const std::string& studentId) {
+        OperationTimer timer;
+        try {
+            if (!Storage::current().findStudent(studentId)) {
+                timer.fail();
+                return std::nullopt;
+            }
+            return Storage::current().listEnrolledCourses(studentId);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("查询选课记录失败：" + std::string(e.what()));
+        }
+    }
+};
+
+// 字符串内存池：按块分配，返回的视图在内存池销毁前始终有效（移动内存池不影响）
+class StringArena {
+private:
+    static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::size_t used = BLOCK_SIZE;   // 当前块已用字节，初始视为已满
+    std::size_t allocated = 0;       // 已分配的总字节
+public:
+    std::string_view store(std::string_view text) {
+        if (text.empty()) return {};
+        if (text.size() > BLOCK_SIZE / 4) {
+            // 大字符串单独成块，下一次存储另起新块
+            blocks.push_back(std::make_unique_for_overwrite<char[]>(text.size()));
+            allocated += text.size();
+            used = BLOCK_SIZE;
+            std::memcpy(blocks.back().get(), text.data(), text.size());
+            return {blocks.back().get(), text.size()};
+        }
+        if (used + text.size() > BLOCK_SIZE) {
+            blocks.push_back(std::make_unique_for_overwrite<char[]>(BLOCK_SIZE));
+            allocated += BLOCK_SIZE;
+            used = 0;
+        }
+        char* dst = blocks.back().get() + used;
+        std::memcpy(dst, text.data(), text.size());
+        used += text.size();
+        return {dst, text.size()};
+    }
+
+    std::size_t bytes() const { return allocated; }
+};
+
+// 内存目录快照：学生/教师/课程按列存储（结构数组），所有字符串存放在同一个内存池中，
+// ID映射为稠密整数下标。首次refresh()全量加载，之后只拉取上次快照后新增或修改的行；
+// 目录中的ID集合与表不一致（个数或ID哈希之和不同，即有行被删除）时在锁外整体重建后替换。
+// 读操作共享锁；刷新只在应用增量和替换目录时持有独占锁
+class CatalogSnapshot {
+public:
+    // 单类实体的内存占用
+    struct Footprint {
+        std::size_t count = 0;
+        std::size_t textBytes = 0;     // 字符串内容字节（位于内存池）
+        std::size_t columnBytes = 0;   // 列数组字节
+        std::size_t indexBytes = 0;    // ID索引估算字节
+
+        double bytesPerEntity() const {
+            return count ? static_cast<double>(textBytes + columnBytes + indexBytes) / count : 0.0;
+        }
+    };
+
+    struct MemoryReport {
+        Footprint students, teachers, courses;
+        std::size_t arenaBytes = 0;    // 内存池已分配字节（含块内未用空间及更新遗留的旧字符串）
+    };
+
+    // 从数据库刷新：返回本次拉取的行数。查询与全量重建都在锁外进行，独占锁只在应用增量与替换目录时持有
+    std::size_t refresh() {
+        std::lock_guard serial(refreshMtx);
+        auto conn = DBUtil::pool().acquire();
+        auto txn = conn.snapshot();
+        // 快照事务的第一条语句确定快照，之后各查询看到同一时刻的数据
+        std::string next = conn.exec(txn, "catalog_watermark")[0][0].as<std::string>();
+        pqxx::result checksums = conn.exec(txn, "catalog_checksums");
+        // 增量应用后目录的ID集合应与表一致；只比较行数会漏掉“删一行、增一行”，因此同时比较ID哈希之和
+        auto matches = [&](const auto& table, const char* name) {
+            return table.id.size() == checksums[0][name].as<std::size_t>() &&
+                   table.idHash == checksums[0][std::string(name) + "_hash"].as<std::int64_t>();
+        };
+
+        Rows rows = fetch(conn, txn, watermark);
+        std::size_t fetched = rows.size();
+        bool rebuild = !watermark;
+        if (watermark) {
+            std::unique_lock lock(mtx);
+            apply(data, rows);
+            if (matches(data.students, "students") && matches(data.teachers, "teachers") && matches(data.courses, "courses")) {
+                sortOrder(data.students);
+                sortOrder(data.teachers);
+                sortOrder(data.courses);
+                watermark = next;
+            } else {
+                rebuild = true;   // 有行被删除
+            }
+        }
+        if (rebuild && watermark) {
+            rows = fetch(conn, txn, std::nullopt);
+            fetched += rows.size();
+        }
+        conn.commit(txn);
+        if (!rebuild) return fetched;
+
+        // 首次加载或有行被删除：在锁外构建新的内存池与列，替换前读操作照常使用原目录
+        Tables fresh;
+        apply(fresh, rows);
+        sortOrder(fresh.students);
+        sortOrder(fresh.teachers);
+        sortOrder(fresh.courses);
+        {
+            std::unique_lock lock(mtx);
+            std::swap(data, fresh);
+            watermark = std::move(next);
+        }
+        return fetched;   // 原目录随fresh在锁外释放
+    }
+
+    Student getStudentById(const std::string& id) const {
+        std::shared_lock lock(mtx);
+        auto it = data.students.index.find(id);
+        if (it == data.students.index.end()) throw std::runtime_error("学生ID【" + id + "】不存在");
+        return student(it->second);
+    }
+
+    Teacher getTeacherById(const std::string& id) const {
+        std::shared_lock lock(mtx);
+        auto it = data.teachers.index.find(id);
+        if (it == data.teachers.index.end()) throw std::runtime_error("教师ID【" + id + "】不存在");
+        return teacher(it->second);
+    }
+
+    Course getCourseById(const std::string& id) const {
+        std::shared_lock lock(mtx);
+        auto it = data.courses.index.find(id);
+        if (it == data.courses.index.end()) throw std::runtime_error("课程ID【" + id + "】不存在");
+        return course(it->second);
+    }
+
+    // 以下按ID排序返回
+    std::vector<Student> getAllStudents() const {
+        std::shared_lock lock(mtx);
+        std::vector<Student> result;
+        result.reserve(data.students.order.size());
+        for (auto i : data.students.order) result.push_back(student(i));
+        return result;
+    }
+
+    std::vector<Teacher> getAllTeachers() const {
+        std::shared_lock lock(mtx);
+        std::vector<Teacher> result;
+        result.reserve(data.teachers.order.size());
+        for (auto i : data.teachers.order) result.push_back(teacher(i));
+        return result;
+    }
+
+    std::vector<Course> getAllCourses() const {
+        std::shared_lock lock(mtx);
+        std::vector<Course> result;
+        result.reserve(data.courses.order.size());
+        for (auto i : data.courses.order) result.push_back(course(i));
+        return result;
+    }
+
+    MemoryReport memory() const {
+        std::shared_lock lock(mtx);
+        MemoryReport report;
+        report.students = footprint(data.students, 3 * sizeof(std::string_view));
+        report.teachers = footprint(data.teachers, 3 * sizeof(std::string_view));
+        report.courses = footprint(data.courses, 2 * sizeof(std::string_view) + sizeof(std::uint8_t) + sizeof(std::uint32_t));
+        report.arenaBytes = data.arena.bytes();
+        return report;
+    }
+
+private:
+    static constexpr std::uint32_t NO_TEACHER = std::numeric_limits<std::uint32_t>::max();
+
+    // 学生与教师结构相同：ID、姓名及一个附加文本列（专业/院系）
+    struct PersonColumns {
+        std::vector<std::string_view> id, name, extra;
+        std::unordered_map<std::string_view, std::uint32_t> index;
+        std::vector<std::uint32_t> order;   // 按ID排序的下标
+        std::size_t textBytes = 0;
+        std::int64_t idHash = 0;            // 已加载ID的hashtext之和
+    };
+
+    struct CourseColumns {
+        std::vector<std::string_view> id, name;
+        std::vector<std::uint8_t> credit;
+        std::vector<std::uint32_t> teacher;  // 授课教师在teachers中的下标
+        std::unordered_map<std::string_view, std::uint32_t> index;
+        std::vector<std::uint32_t> order;
+        std::size_t textBytes = 0;
+        std::int64_t idHash = 0;
+    };
+
+    // 一份完整的目录：列中的字符串视图指向同一内存池，整体移动（交换）后仍然有效
+    struct Tables {
+        StringArena arena;
+        PersonColumns students, teachers;
+        CourseColumns courses;
+    };
+
+    // 一次拉取的三类行
+    struct Rows {
+        pqxx::result teachers, courses, students;
+
+        std::size_t size() const { return teachers.size() + courses.size() + students.size(); }
+    };
+
+    mutable std::shared_mutex mtx;
+    std::mutex refreshMtx;   // 串行化refresh()，水位只由持有者读写
+    Tables data;
+    std::optional<std::string> watermark;
+
+    // since为空时拉取全部行
+    static Rows fetch(ConnectionPool::Lease& conn, DbTxn& txn, const std::optional<std::string>& since) {
+        Rows rows;
+        rows.teachers = conn.exec(txn, "catalog_teachers_since", since);
+        rows.courses = conn.exec(txn, "catalog_courses_since", since);
+        rows.students = conn.exec(txn, "catalog_students_since", since);
+        return rows;
+    }
+
+    // 教师先于课程应用，保证课程的授课教师下标可解析
+    static void apply(Tables& t, const Rows& rows) {
+        TeacherDecoder decodeTeacher(rows.teachers);
+        int hash = rows.teachers.column_number("id_hash");
+        for (const auto& row : rows.teachers) upsert(t, t.teachers, decodeTeacher(row), row[hash].as<std::int32_t>());
+        CourseDecoder decodeCourse(rows.courses);
+        hash = rows.courses.column_number("id_hash");
+        for (const auto& row : rows.courses) upsert(t, decodeCourse(row), row[hash].as<std::int32_t>());
+        StudentDecoder decodeStudent(rows.students);
+        hash = rows.students.column_number("id_hash");
+        for (const auto& row : rows.students) upsert(t, t.students, decodeStudent(row), row[hash].as<std::int32_t>());
+    }
+
+    // 内容未变时复用原字符串，避免内存池增长
+    static std::string_view intern(StringArena& arena, std::string_view current, const std::string& value,
+                                   std::size_t& textBytes) {
+        if (current == value) return current;
+        textBytes += value.size();
+        return arena.store(value);
+    }
+
+    // idHash为数据库中该行ID的hashtext，新增行时计入ID哈希之和
+    template<typename Entity>
+    static void upsert(Tables& t, PersonColumns& table, const Entity& e, std::int32_t idHash) {
+        const std::string& extra = [&]() -> const std::string& {
+            if constexpr (std::is_same_v<Entity, Student>) return e.getMajor();
+            else return e.getDepartment();
+        }();
+        auto it = table.index.find(e.getId());
+        if (it != table.index.end()) {
+            auto i = it->second;
+            table.name[i] = intern(t.arena, table.name[i], e.getName(), table.textBytes);
+            table.extra[i] = intern(t.arena, table.extra[i], extra, table.textBytes);
+            return;
+        }
+        auto i = static_cast<std::uint32_t>(table.id.size());
+        table.id.push_back(intern(t.arena, {}, e.getId(), table.textBytes));
+        table.name.push_back(intern(t.arena, {}, e.getName(), table.textBytes));
+        table.extra.push_back(intern(t.arena, {}, extra, table.textBytes));
+        table.index.emplace(table.id.back(), i);
+        table.idHash += idHash;
+    }
+
+    static void upsert(Tables& t, const Course& c, std::int32_t idHash) {
+        auto& courses = t.courses;
+        auto teacherIt = t.teachers.index.find(c.getTeacherId());
+        std::uint32_t teacherIdx = teacherIt == t.teachers.index.end() ? NO_TEACHER : teacherIt->second;
+        auto it = courses.index.find(c.getId());
+        if (it != courses.index.end()) {
+            auto i = it->second;
+            courses.name[i] = intern(t.arena, courses.name[i], c.getName(), courses.textBytes);
+            courses.credit[i] = static_cast<std::uint8_t>(c.getCredit());
+            courses.teacher[i] = teacherIdx;
+            return;
+        }
+        auto i = static_cast<std::uint32_t>(courses.id.size());
+        courses.id.push_back(intern(t.arena, {}, c.getId(), courses.textBytes));
+        courses.name.push_back(intern(t.arena, {}, c.getName(), courses.textBytes));
+        courses.credit.push_back(static_cast<std::uint8_t>(c.getCredit()));
+        courses.teacher.push_back(teacherIdx);
+        courses.index.emplace(courses.id.back(), i);
+        courses.idHash += idHash;
+    }
+
+    template<typename Table>
+    static void sortOrder(Table& table) {
+        if (table.order.size() == table.id.size()) return;
+        table.order.resize(table.id.size());
+        std::iota(table.order.begin(), table.order.end(), 0u);
+        std::ranges::sort(table.order, {}, [&](std::uint32_t i) { return table.id[i]; });
+    }
+
+    Student student(std::uint32_t i) const {
+        const auto& students = data.students;
+        return Student(std::string(students.id[i]), std::string(students.name[i]), std::string(students.extra[i]));
+    }
+
+    Teacher teacher(std::uint32_t i) const {
+        const auto& teachers = data.teachers;
+        return Teacher(std::string(teachers.id[i]), std::string(teachers.name[i]), std::string(teachers.extra[i]));
+    }
+
+    // 授课教师不在目录中时教师ID为空
+    Course course(std::uint32_t i) const {
+        const auto& courses = data.courses;
+        const auto& teachers = data.teachers;
+        std::string teacherId = courses.teacher[i] == NO_TEACHER ? std::string() : std::string(teachers.id[courses.teacher[i]]);
+        return Course(std::string(courses.id[i]), std::string(courses.name[i]), courses.credit[i], std::move(teacherId));
+    }
+
+    // 哈希索引按每个节点（键+值+next指针）加桶数组估算
+    template<typename Table>
+    static Footprint footprint(const Table& table, std::size_t rowColumnBytes) {
+        Footprint f;
+        f.count = table.id.size();
+        f.textBytes = table.textBytes;
+        f.columnBytes = table.id.size() * rowColumnBytes + table.order.capacity() * sizeof(std::uint32_t);
+        f.indexBytes = table.index.size() * (sizeof(std::string_view) + sizeof(std::uint32_t) + 2 * sizeof(void*)) +
+                       table.index.bucket_count() * sizeof(void*);
+        return f;
+    }
+};
+
+// 批量导入结果
+struct ImportResult {
+    std::size_t total = 0;     // CSV数据行数
+    std::size_t inserted = 0;  // 新增行数
+    std::size_t skipped = 0;   // 跳过行数（ID已存在或引用的教师不存在）
+};
+
+// 成绩册中被拒绝的一行
+struct RejectedScore {
+    std::size_t line;          // CSV行号（含表头，从1开始）
+    std::string studentId;
+    std::string reason;
+};
+
+// 成绩册上传结果
+struct GradebookResult {
+    std::size_t total = 0;     // CSV数据行数
+    std::size_t upserted = 0;  // 新增或更新的成绩数
+    std::vector<RejectedScore> rejected;
+};
+
+// 批量导入：CSV经COPY写入临时表，再以与单条新增相同的ON CONFLICT DO NOTHING语义合并入正式表
+class BulkImportRepository {
+public:
+    // CSV表头：id,name,major
+    ImportResult importStudents(std::istream& in) {
+        OperationTimer timer;
+        return importCsv(in, "students", "id, name, major", "", nullptr);
+    }
+
+    // CSV表头：id,name,department
+    ImportResult importTeachers(std::istream& in) {
+        OperationTimer timer;
+        return importCsv(in, "teachers", "id, name, department", "", nullptr);
+    }
+
+    // CSV表头：id,name,credit,teacher_id；授课教师不存在的课程计为跳过
+    ImportResult importCourses(std::istream& in) {
+        OperationTimer timer;
+        return importCsv(in, "courses", "id, name, credit, teacher_id",
+                         " WHERE EXISTS (SELECT 1 FROM teachers t WHERE t.id = i.teacher_id)",
+                         [](const std::vector<std::string>& fields) {
+                             int credit = 0;
+                             auto [ptr, ec] = std::from_chars(fields[2].data(), fields[2].data() + fields[2].size(), credit);
+                             if (ec != std::errc() || ptr != fields[2].data() + fields[2].size() || credit < 1 || credit > 10) {
+                                 throw std::runtime_error("学分【" + fields[2] + "】无效，应为1-10的整数");
+                             }
+                         });
+    }
+
+    // 上传课程成绩册（CSV表头：student_id,score）：COPY写入临时表后，
+    // 一条语句完成选课校验并upsert全部有效行，整个成绩册在同一事务内生效
+    GradebookResult uploadGradebook(const std::string& courseId, std::istream& in) {
+        OperationTimer timer;
+        GradebookResult result;
+        try {
+            std::string line;
+            if (!CsvUtil::readLine(in, line, true)) throw std::runtime_error("文件为空");
+            std::size_t lineNo = 1;
+
+            auto conn = DBUtil::pool().acquire();
+            auto txn = conn.write();
+            conn.execSql(txn, "CREATE TEMP TABLE gradebook_upload (line_no bigint, student_id text, score float8) ON COMMIT DROP");
+            {
+                auto stream = pqxx::stream_to::table(txn, {"gradebook_upload"});
+                while (CsvUtil::readLine(in, line, false)) {
+                    ++lineNo;
+                    if (line.empty() || line == "\r") continue;
+                    ++result.total;
+                    auto fields = CsvUtil::splitLine(line);
+                    if (fields.size() != 2) {
+                        result.rejected.push_back({lineNo, fields[0], "应有2列，实际" + std::to_string(fields.size()) + "列"});
+                        continue;
+                    }
+                    double score = 0.0;
+                    auto [ptr, ec] = std::from_chars(fields[1].data(), fields[1].data() + fields[1].size(), score);
+                    if (ec != std::errc() || ptr != fields[1].data() + fields[1].size() || score < 0 || score > 100) {
+                        result.rejected.push_back({lineNo, fields[0], "成绩【" + fields[1] + "】无效，应为0-100的数字"});
+                        continue;
+                    }
+                    stream.write_values(static_cast<long long>(lineNo), fields[0], score);
+                }
+                stream.complete();
+                ++DBUtil::roundTrips();
+            }
+            // 同一学生在文件中出现多次时以最后一行为准，其余行拒绝
+            pqxx::result res = conn.execSql(txn,
+                "WITH checked AS ("
+                "  SELECT g.line_no, g.student_id, g.score,"
+                "         CASE WHEN NOT EXISTS (SELECT 1 FROM courses WHERE id = $1) THEN '课程不存在'"
+                "              WHEN NOT EXISTS (SELECT 1 FROM students s WHERE s.id = g.student_id) THEN '学生不存在'"
+                "              WHEN e.student_id IS NULL THEN '学生未选该课程'"
+                "              WHEN ROW_NUMBER() OVER (PARTITION BY g.student_id ORDER BY g.line_no DESC) > 1"
+                "                   THEN '文件中重复，以最后一行为准'"
+                "         END AS reason"
+                "  FROM gradebook_upload g"
+                "  LEFT JOIN enrollments e ON e.student_id = g.student_id AND e.course_id = $1"
+                "), upserted AS ("
+                "  INSERT INTO scores (student_id, course_id, score)"
+                "  SELECT student_id, $1, score FROM checked WHERE reason IS NULL"
+                "  ON CONFLICT (student_id, course_id) DO UPDATE SET score = EXCLUDED.score"
+                "  RETURNING 1"
+                ")"
+                "SELECT u.n AS upserted, c.line_no, c.student_id, c.reason"
+                "  FROM (SELECT count(*) AS n FROM upserted) u"
+                "  LEFT JOIN checked c ON c.reason IS NOT NULL"
+                "  ORDER BY c.line_no",
+                courseId
+            );
+            conn.commit(txn);
+            result.upserted = res[0]["upserted"].as<std::size_t>();
+            for (const auto& row : res) {
+                if (row["line_no"].is_null()) continue;
+                result.rejected.push_back({
+                    row["line_no"].as<std::size_t>(),
+                    row["student_id"].as<std::string>(),
+                    row["reason"].as<std::string>()
+                });
+            }
+            std::ranges::sort(result.rejected, {}, &RejectedScore::line);
+            return result;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("上传成绩册失败：" + std::string(e.what()));
+        }
+    }
+
+private:
+    ImportResult importCsv(std::istream& in, const std::string& table, const std::string& columns,
+                           const std::string& mergeFilter,
+                           const std::function<void(const std::vector<std::string>&)>& validate) {
+        ImportResult result;
+        std::size_t lineNo = 0;
+        try {
+            const std::size_t columnCount = std::ranges::count(columns, ',') + 1;
+            const std::string staging = "import_" + table;
+            std::string line;
+            if (!CsvUtil::readLine(in, line, true)) throw std::runtime_error("文件为空");
+            ++lineNo;  // 首行为表头
+
+            auto conn = DBUtil::pool().acquire();
+            auto txn = conn.write();
+            conn.execSql(txn, "CREATE TEMP TABLE " + staging + " ON COMMIT DROP AS SELECT " + columns +
+                     " FROM " + table + " WITH NO DATA");
+            {
+                auto stream = pqxx::stream_to::table(txn, {staging});
+                while (CsvUtil::readLine(in, line, false)) {
+                    ++lineNo;
+                    if (line.empty() || line == "\r") continue;
+                    auto fields = CsvUtil::splitLine(line);
+                    if (fields.size() != columnCount) {
+                        throw std::runtime_error("应有" + std::to_string(columnCount) + "列，实际" +
+                                                 std::to_string(fields.size()) + "列");
+                    }
+                    if (validate) validate(fields);
+                    stream.write_row(fields);
+                    ++result.total;
+                }
+                stream.complete();
+                ++DBUtil::roundTrips();
+            }
+            lineNo = 0;
+            pqxx::result res = conn.execSql(txn, "INSERT INTO " + table + " (" + columns + ") SELECT " + columns +
+                                        " FROM " + staging + " i" + mergeFilter + " ON CONFLICT (id) DO NOTHING");
+            conn.commit(txn);
+            result.inserted = res.affected_rows();
+            result.skipped = result.total - result.inserted;
+            return result;
+        } catch (const std::exception& e) {
+            std::string where = lineNo > 0 ? "第" + std::to_string(lineNo) + "行：" : "";
+            throw std::runtime_error("批量导入" + table + "失败：" + where + std::string(e.what()));
+        }
+    }
+};
+
+} // export